@@ -0,0 +1,191 @@
+/*
+
+  Dictionary Benchmark
+  Copyright (c) Anatoli Arkhipenko, 2020
+  All Rights Reserved
+
+  Measures insert / lookup / miss lookup / remove / json() / jload()
+  throughput (ops per second) and heap consumption over configurable
+  entry counts and key distributions:
+
+    sequential    - key000000, key000001, ...
+    random        - pseudo-random 8-character keys (deterministic seed)
+    common-prefix - sensor/temp/000000, sensor/temp/000001, ...
+
+  Run this before and after any change to Dictionary::insert/search
+  to quantify the effect.
+
+  Compile and run on ESP32 boards only
+
+*/
+
+// Benchmark the configuration you actually deploy with:
+//#define _DICT_CRC 16
+//#define _DICT_CRC 32
+//#define _DICT_CRC 64
+
+//#define _DICT_PACK_STRUCTURES
+//#define _DICT_COMPRESS_SHOCO
+//#define _DICT_COMPRESS_SMAZ
+//#define _DICT_USE_PSRAM  // for ESP32 only
+//#define _DICT_BALANCED
+//#define _DICT_HASH_FNV
+//#define _DICT_ARENA
+//#define _DICT_SSO
+
+//#define _DICT_KEYLEN 64
+//#define _DICT_VALLEN 256
+
+#include <Dictionary.h>
+
+// how many entries per run - adjust to your board's memory
+#define BM_COUNT      1000
+// lookups per measurement (hits and misses)
+#define BM_LOOKUPS    5000
+
+#define _PP(a) Serial.print(a);
+#define _PL(a) Serial.println(a);
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+#define BM_FREEHEAP() ESP.getFreeHeap()
+#else
+#define BM_FREEHEAP() 0  // no portable free-heap call on this core
+#endif
+
+enum BmDistribution { BM_SEQUENTIAL, BM_RANDOM, BM_PREFIX };
+
+// deterministic xorshift PRNG so every run benchmarks the same key set
+static uint32_t bmSeed;
+uint32_t bmRand() {
+  bmSeed ^= bmSeed << 13;
+  bmSeed ^= bmSeed >> 17;
+  bmSeed ^= bmSeed << 5;
+  return bmSeed;
+}
+
+void bmKey(char* buf, int i, BmDistribution dist) {
+  switch (dist) {
+    case BM_SEQUENTIAL:
+      sprintf(buf, "key%06d", i);
+      break;
+    case BM_RANDOM:
+      sprintf(buf, "k%07lu", (unsigned long)(bmRand() % 10000000UL));
+      break;
+    case BM_PREFIX:
+      sprintf(buf, "sensor/temp/%06d", i);
+      break;
+  }
+}
+
+void bmReport(const char* what, uint32_t ops, uint32_t us) {
+  _PP("  "); _PP(what); _PP(": "); _PP(ops); _PP(" ops in "); _PP(us); _PP(" us = ");
+  _PP(us ? (uint32_t)((uint64_t)ops * 1000000UL / us) : 0); _PL(" ops/sec");
+}
+
+void bmRun(const char* name, BmDistribution dist) {
+  char kb[_DICT_KEYLEN + 1];
+  char vb[32];
+  uint32_t t, elapsed;
+  uint32_t heapBefore = BM_FREEHEAP();
+
+  _PP(name); _PL(":");
+
+  Dictionary& d = *(new Dictionary(BM_COUNT));
+
+  // --- insert ---
+  bmSeed = 2463534242UL;
+  t = micros();
+  for (int i = 0; i < BM_COUNT; i++) {
+    bmKey(kb, i, dist);
+    sprintf(vb, "value number %d", i);
+    d(kb, vb);
+  }
+  elapsed = micros() - t;
+  bmReport("insert", BM_COUNT, elapsed);
+  _PP("  entries: "); _PP(d.count());
+  _PP(", heap used: "); _PL(heapBefore - BM_FREEHEAP());
+
+  // --- random hit lookups ---
+  // sequential/prefix keys are derived from a random index; random keys
+  // are replayed from the same PRNG sequence that generated them
+  bmSeed = 2463534242UL;
+  uint32_t found = 0;
+  t = micros();
+  for (int i = 0; i < BM_LOOKUPS; i++) {
+    if (dist == BM_RANDOM) {
+      if (i % BM_COUNT == 0) bmSeed = 2463534242UL;
+      bmKey(kb, i, BM_RANDOM);
+    }
+    else {
+      bmKey(kb, (int)(bmRand() % BM_COUNT), dist);
+    }
+    if (d.get(kb)) found++;
+  }
+  elapsed = micros() - t;
+  bmReport("lookup (hit)", BM_LOOKUPS, elapsed);
+  if (found != BM_LOOKUPS) {
+    _PP("  WARNING: only "); _PP(found); _PL(" lookups hit");
+  }
+
+  // --- miss lookups ---
+  t = micros();
+  for (int i = 0; i < BM_LOOKUPS; i++) {
+    sprintf(kb, "missing%06d", i);
+    d.get(kb);
+  }
+  elapsed = micros() - t;
+  bmReport("lookup (miss)", BM_LOOKUPS, elapsed);
+
+  // --- json serialization ---
+  t = micros();
+  String j = d.json();
+  elapsed = micros() - t;
+  bmReport("json()", d.count(), elapsed);
+  _PP("  json size: "); _PL(j.length());
+
+  // --- jload deserialization ---
+  Dictionary& d2 = *(new Dictionary(BM_COUNT));
+  t = micros();
+  d2.jload(j);
+  elapsed = micros() - t;
+  bmReport("jload()", d2.count(), elapsed);
+  delete (&d2);
+
+  // --- remove ---
+  bmSeed = 2463534242UL;
+  t = micros();
+  for (int i = 0; i < BM_COUNT; i++) {
+    bmKey(kb, i, dist);
+    d.remove(kb);
+  }
+  elapsed = micros() - t;
+  bmReport("remove", BM_COUNT, elapsed);
+  _PP("  entries left: "); _PL(d.count());
+
+  delete (&d);
+  _PP("  heap leaked: "); _PL(heapBefore - BM_FREEHEAP());
+  _PL();
+}
+
+// ======================================================================
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+
+  _PL("Dictionary benchmark"); _PL();
+  _PP("entries per run: "); _PL(BM_COUNT);
+  _PP("lookups per run: "); _PL(BM_LOOKUPS);
+  _PP("free heap at start: "); _PL(BM_FREEHEAP());
+  _PL();
+
+  bmRun("sequential keys", BM_SEQUENTIAL);
+  bmRun("random keys", BM_RANDOM);
+  bmRun("common-prefix keys", BM_PREFIX);
+
+  _PP("free heap at end: "); _PL(BM_FREEHEAP());
+  _PL("benchmark done");
+}
+
+void loop() {
+
+}
@@ -0,0 +1,101 @@
+/*
+
+  Host-native micro-benchmark harness for the Dictionary library.
+
+  Runs the hot paths (insert, hit/miss lookup, remove, json, jload) in a
+  plain process so they can be examined with perf, valgrind, sanitizers
+  or a debugger - something an Arduino board cannot offer.
+
+    ./dict_bench [entries] [lookups]
+
+*/
+
+#include <Dictionary.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void report(const char* what, long ops, double sec) {
+    printf("%-14s %8ld ops in %8.3f ms = %10.0f ops/sec\n",
+           what, ops, sec * 1e3, sec > 0 ? ops / sec : 0);
+}
+
+int main(int argc, char** argv) {
+    long entries = argc > 1 ? atol(argv[1]) : 100000;
+    long lookups = argc > 2 ? atol(argv[2]) : entries;
+    char kb[64], vb[64];
+    double t;
+
+    printf("dict_bench: %ld entries, %ld lookups\n", entries, lookups);
+
+    Dictionary d(entries);
+
+    t = now_sec();
+    for (long i = 0; i < entries; i++) {
+        snprintf(kb, sizeof(kb), "key%08ld", i);
+        snprintf(vb, sizeof(vb), "value number %ld", i);
+        if (d.insert(kb, vb) != DICTIONARY_OK) {
+            fprintf(stderr, "insert failed at %ld\n", i);
+            return 1;
+        }
+    }
+    report("insert", entries, now_sec() - t);
+
+    srand(12345);
+    t = now_sec();
+    long found = 0;
+    for (long i = 0; i < lookups; i++) {
+        snprintf(kb, sizeof(kb), "key%08ld", (long)(rand() % entries));
+        if (d.get(kb)) found++;
+    }
+    report("lookup hit", lookups, now_sec() - t);
+    if (found != lookups) {
+        fprintf(stderr, "expected %ld hits, got %ld\n", lookups, found);
+        return 1;
+    }
+
+    t = now_sec();
+    for (long i = 0; i < lookups; i++) {
+        snprintf(kb, sizeof(kb), "missing%08ld", i);
+        if (d.get(kb)) {
+            fprintf(stderr, "unexpected hit on %s\n", kb);
+            return 1;
+        }
+    }
+    report("lookup miss", lookups, now_sec() - t);
+
+    t = now_sec();
+    String j = d.json();
+    report("json", entries, now_sec() - t);
+    printf("%-14s %8u bytes\n", "json size", (unsigned)j.length());
+
+    Dictionary d2(entries);
+    t = now_sec();
+    if (d2.jload(j) != DICTIONARY_OK) {
+        fprintf(stderr, "jload failed\n");
+        return 1;
+    }
+    report("jload", entries, now_sec() - t);
+
+    t = now_sec();
+    for (long i = 0; i < entries; i++) {
+        snprintf(kb, sizeof(kb), "key%08ld", i);
+        d.remove(kb);
+    }
+    report("remove", entries, now_sec() - t);
+
+    if (d.count() != 0) {
+        fprintf(stderr, "expected empty dictionary, %u entries left\n", (unsigned)d.count());
+        return 1;
+    }
+
+    printf("done\n");
+    return 0;
+}
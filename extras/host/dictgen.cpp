@@ -0,0 +1,111 @@
+/*
+
+  Offline generator for FlashDictionary tables.
+
+  Reads a JSON document (the same dialect Dictionary::jload() accepts,
+  including comment lines) and emits a C++ header with the key/value
+  data blob, the sorted offset table and a ready-to-use FlashDictionary
+  object - all PROGMEM-resident, so an immutable table (localization
+  strings, default configs) costs zero RAM and zero startup parsing.
+
+    ./dictgen <input.json> <identifier> > MyTable.h
+
+  then in a sketch:
+
+    #include "MyTable.h"
+    Serial.println(my_table["greeting"]);
+
+*/
+
+#include <Dictionary.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+struct pair {
+    std::string key;
+    std::string val;
+};
+
+// emit a string (including its terminator) as an unambiguous C literal:
+// printable ASCII stays readable, everything else becomes a fixed-width
+// octal escape so a following digit can never extend it
+static void emit_literal(const std::string& s) {
+    printf("    \"");
+    for (size_t i = 0; i < s.size(); i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"')       printf("\\\"");
+        else if (c == '\\') printf("\\\\");
+        else if (c >= 0x20 && c < 0x7f) putchar(c);
+        else printf("\\%03o", c);
+    }
+    printf("\\000\"\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <input.json> <identifier>\n", argv[0]);
+        return 1;
+    }
+    const char* path = argv[1];
+    const char* name = argv[2];
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "dictgen: cannot open %s\n", path);
+        return 1;
+    }
+    std::string js;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) js.append(buf, n);
+    fclose(f);
+
+    Dictionary d(100);
+    int8_t rc = d.jload(String(js.c_str()));
+    if (rc) {
+        fprintf(stderr, "dictgen: jload failed on %s (rc=%d)\n", path, rc);
+        return 1;
+    }
+
+    // sort by plain strcmp - the order FlashDictionary::find() expects
+    std::vector<pair> pairs(d.count());
+    for (size_t i = 0; i < d.count(); i++) {
+        pairs[i].key = d.key(i).c_str();
+        pairs[i].val = d.value(i).c_str();
+    }
+    std::sort(pairs.begin(), pairs.end(),
+              [](const pair& a, const pair& b) { return strcmp(a.key.c_str(), b.key.c_str()) < 0; });
+
+    printf("// Generated by dictgen from %s - do not edit.\n", path);
+    printf("// %zu entries.\n\n", pairs.size());
+    printf("#ifndef _FLASH_DICT_%s_H_\n#define _FLASH_DICT_%s_H_\n\n", name, name);
+    printf("#include <FlashDictionary.h>\n\n");
+
+    printf("static const char %s_data[] PROGMEM =\n", name);
+    for (size_t i = 0; i < pairs.size(); i++) {
+        emit_literal(pairs[i].key);
+        emit_literal(pairs[i].val);
+    }
+    printf(";\n\n");
+
+    printf("static const FlashDictionary::entry %s_entries[] PROGMEM = {\n", name);
+    uint32_t off = 0;
+    for (size_t i = 0; i < pairs.size(); i++) {
+        uint32_t koff = off;
+        uint32_t voff = koff + (uint32_t)pairs[i].key.size() + 1;
+        off = voff + (uint32_t)pairs[i].val.size() + 1;
+        printf("    { %u, %u },\n", koff, voff);
+    }
+    printf("};\n\n");
+
+    printf("static const FlashDictionary %s(%s_entries, %s_data, %zu);\n\n",
+           name, name, name, pairs.size());
+    printf("#endif\n");
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+
+  Offline generator for the smaz compression trie.
+
+  Builds a prefix trie over the smaz reverse codebook (the 254 strings
+  of Smaz_rcb, which define the wire format) and emits it as a C header
+  of static tables:
+
+    ./smazgen > ../../src/smaz/smaz_trie.h
+
+  smaz_compress() walks this trie to find the longest codebook string
+  at each input position in a single linear pass - no per-position
+  hashing of every substring length and no memcmp verification. The
+  codebook is taken straight from smaz.c, so the generator cannot drift
+  from the wire format.
+
+*/
+
+#include "../../src/smaz/smaz.c"
+
+#include <stdio.h>
+
+/* 254 strings of at most 7 bytes - 2048 nodes is generous */
+#define MAXNODES 2048
+
+static unsigned char t_ch[MAXNODES];    /* byte on the edge from the parent */
+static unsigned char t_code[MAXNODES];  /* code ending here, 0xFF if none */
+static short         t_first[MAXNODES]; /* first child, -1 */
+static short         t_next[MAXNODES];  /* next sibling, -1 */
+static int           t_cnt = 1;         /* node 0 is the (virtual) root */
+
+static int child(int parent, unsigned char c) {
+    int n = t_first[parent];
+    int prev = -1;
+
+    while (n != -1 && t_ch[n] != c) {
+        prev = n;
+        n = t_next[n];
+    }
+    if (n != -1) return n;
+
+    /* append a fresh node at the end of the sibling chain, so the node
+       order (and the emitted header) is deterministic */
+    n = t_cnt++;
+    if (n >= MAXNODES) {
+        fprintf(stderr, "smazgen: trie overflow\n");
+        return -1;
+    }
+    t_ch[n] = c;
+    t_code[n] = 0xFF;
+    t_first[n] = -1;
+    t_next[n] = -1;
+    if (prev == -1) t_first[parent] = n;
+    else t_next[prev] = n;
+    return n;
+}
+
+int main(void) {
+    int i, j, maxlen = 0;
+
+    t_ch[0] = 0;
+    t_code[0] = 0xFF;
+    t_first[0] = -1;
+    t_next[0] = -1;
+
+    for (i = 0; i < 254; i++) {
+        const char* s = Smaz_rcb[i];
+        int n = 0;
+
+        for (j = 0; s[j]; j++) {
+            n = child(n, (unsigned char)s[j]);
+            if (n < 0) return 1;
+        }
+        if (j > maxlen) maxlen = j;
+        if (t_code[n] != 0xFF) {
+            fprintf(stderr, "smazgen: duplicate codebook string at %d\n", i);
+            return 1;
+        }
+        t_code[n] = (unsigned char)i;
+    }
+
+    printf("/* smaz_trie.h -- generated by extras/host/smazgen, do not edit.\n");
+    printf(" *\n");
+    printf(" * Prefix trie over the smaz reverse codebook: Smaz_trie_root indexes\n");
+    printf(" * the depth-1 node by first byte (-1 = no codebook string starts\n");
+    printf(" * with it), deeper levels are first-child/next-sibling chains. A\n");
+    printf(" * node's code is the codebook byte for the string ending there\n");
+    printf(" * (0xFF = none; real codes stop at 0xFD, 0xFE/0xFF are the verbatim\n");
+    printf(" * escapes). Codebook strings are unique, so the longest trie match\n");
+    printf(" * is exactly the entry the original hash-probing encoder found -\n");
+    printf(" * the compressed output is byte-identical.\n");
+    printf(" */\n");
+    printf("#ifndef _SMAZ_TRIE_H_\n");
+    printf("#define _SMAZ_TRIE_H_\n\n");
+    printf("#define SMAZ_TRIE_MAX %d  /* longest codebook string */\n\n", maxlen);
+    printf("typedef struct {\n");
+    printf("    unsigned char ch;     /* byte on the edge from the parent */\n");
+    printf("    unsigned char code;   /* codebook byte emitted here, 0xFF = none */\n");
+    printf("    short         first;  /* first child, -1 = leaf */\n");
+    printf("    short         next;   /* next sibling, -1 = last */\n");
+    printf("} SmazTrieNode;\n\n");
+
+    printf("static const short Smaz_trie_root[256] = {");
+    for (i = 0; i < 256; i++) {
+        int n = t_first[0];
+
+        while (n != -1 && t_ch[n] != (unsigned char)i) n = t_next[n];
+        if (i % 16 == 0) printf("\n    ");
+        printf("%4d,", n);
+    }
+    printf("\n};\n\n");
+
+    printf("static const SmazTrieNode Smaz_trie[%d] = {", t_cnt);
+    for (i = 0; i < t_cnt; i++) {
+        if (i % 4 == 0) printf("\n    ");
+        printf("{0x%02x,0x%02x,%4d,%4d}, ", t_ch[i], t_code[i], t_first[i], t_next[i]);
+    }
+    printf("\n};\n\n");
+    printf("#endif /* _SMAZ_TRIE_H_ */\n");
+    return 0;
+}
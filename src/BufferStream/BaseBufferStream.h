@@ -1,7 +1,11 @@
 #ifndef __BaseBufferStream_H__
 #define __BaseBufferStream_H__
 
+#ifdef ARDUINO
 #include <Arduino.h>
+#else
+#include "../Host/HostArduino.h"
+#endif
 
 class BaseBufferStream : public Stream {
 	public:
@@ -1,9 +1,14 @@
 #ifndef __BufferStream_H__
 #define __BufferStream_H__
 
+#ifdef ARDUINO
 #include <Arduino.h>
+#else
+#include "../Host/HostArduino.h"
+#endif
 
 #include "ReadBufferStream.h"
 #include "WriteBufferStream.h"
+#include "ChunkedWriteBufferStream.h"
 
 #endif // __BufferStream_H__
@@ -0,0 +1,99 @@
+#include "ChunkedWriteBufferStream.h"
+
+// chunks go to PSRAM when the library is configured for it and the board
+// has it - same policy as the dictionary nodes themselves
+static void* cwbs_malloc(size_t size) {
+#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
+	// detect once - psramFound() is a non-trivial IDF call and the
+	// answer never changes after boot
+	static bool found = psramFound();
+	void* p = NULL;
+	if (found) p = ps_malloc(size);
+	if (!p) p = malloc(size);
+	return p;
+#else
+	return malloc(size);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ChunkedWriteBufferStream::ChunkedWriteBufferStream(size_t chunkSize) : BaseBufferStream(NULL, 0) {
+	iChunkSize = chunkSize ? chunkSize : 1;
+	iHead = NULL;
+	iTail = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ChunkedWriteBufferStream::~ChunkedWriteBufferStream() {
+	clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ChunkedWriteBufferStream::chunk* ChunkedWriteBufferStream::newChunk() {
+	chunk* c = (chunk*)cwbs_malloc(sizeof(chunk) + iChunkSize);
+
+	if (c == NULL) {
+		return NULL;
+	}
+	c->next = NULL;
+	c->used = 0;
+	if (iTail) {
+		iTail->next = c;
+	}
+	else {
+		iHead = c;
+	}
+	iTail = c;
+	return c;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ChunkedWriteBufferStream::write(uint8_t value) {
+	return write(&value, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ChunkedWriteBufferStream::write(const uint8_t *buffer, size_t size) {
+	size_t written = 0;
+
+	while (written < size) {
+		if (iTail == NULL || iTail->used == iChunkSize) {
+			if (newChunk() == NULL) {
+				break;	// out of memory - report the short count
+			}
+		}
+		size_t room = iChunkSize - iTail->used;
+		size_t n = size - written < room ? size - written : room;
+
+		memcpy((uint8_t*)(iTail + 1) + iTail->used, buffer + written, n);
+		iTail->used += n;
+		written += n;
+	}
+	sz += written;
+	return written;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ChunkedWriteBufferStream::writeTo(Print& out) const {
+	size_t n = 0;
+
+	for (chunk* c = iHead; c; c = c->next) {
+		if (c->used == 0) break;
+		n += out.write((const uint8_t*)(c + 1), c->used);
+	}
+	return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ChunkedWriteBufferStream::clear() {
+	chunk* c = iHead;
+
+	while (c) {
+		chunk* next = c->next;
+		free(c);
+		c = next;
+	}
+	iHead = NULL;
+	iTail = NULL;
+	sz = 0;
+}
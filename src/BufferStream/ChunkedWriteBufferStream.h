@@ -0,0 +1,63 @@
+#ifndef __ChunkedWriteBufferStream_H__
+#define __ChunkedWriteBufferStream_H__
+
+#include "BaseBufferStream.h"
+
+// A growable write target: bytes land in a linked list of fixed-size
+// chunks allocated on demand (from PSRAM when _DICT_USE_PSRAM is set and
+// present), so serializing a dictionary needs neither a jsize() pre-pass
+// nor one giant contiguous allocation - and unlike the fixed
+// WriteBufferStream, nothing is ever silently dropped while memory lasts.
+// The collected bytes are handed out chunk-by-chunk with no intermediate
+// copy: visit them with forEachChunk() or forward them to another
+// Print/Stream (a network client) with writeTo().
+class ChunkedWriteBufferStream : public BaseBufferStream {
+	public:
+		explicit ChunkedWriteBufferStream(size_t chunkSize = 256);
+		~ChunkedWriteBufferStream();
+
+	public:
+		virtual size_t write(uint8_t value);
+		virtual size_t write(const uint8_t *buffer, size_t size);
+
+		// total bytes collected so far (sz tracks the same number)
+		inline size_t size() const { return sz; }
+
+		// hand every filled chunk to the callback as cb(data, len) in
+		// write order; return false from the callback to stop early.
+		// Returns the number of bytes visited.
+		template<typename F> size_t forEachChunk(F cb) const {
+			size_t n = 0;
+			for (chunk* c = iHead; c; c = c->next) {
+				if (c->used == 0) break;
+				if (!cb((const uint8_t*)(c + 1), c->used)) return n + c->used;
+				n += c->used;
+			}
+			return n;
+		}
+
+		// forward everything to another Print (a client connection, a
+		// file) chunk-by-chunk; returns the number of bytes written out
+		size_t writeTo(Print& out) const;
+
+		// drop all collected bytes and release the chunks - the stream
+		// is empty and reusable afterwards
+		void clear();
+
+		using Print::write;
+
+	private:
+		// chunk header; the data bytes follow it in the same allocation
+		struct chunk {
+			chunk*  next;
+			size_t  used;
+		};
+
+		chunk*	newChunk();
+
+		size_t	iChunkSize;
+		chunk*	iHead;
+		chunk*	iTail;
+};
+
+#endif // __ChunkedWriteBufferStream_H__
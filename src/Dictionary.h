@@ -1,5 +1,145 @@
 #include "DictionaryDeclarations.h"
 
+#ifdef _DICT_ARENA
+
+// ==== ARENA ALLOCATOR ==============================================
+// Allocations are carved out of large blocks with a simple pointer bump.
+// Freed chunks go onto power-of-two size-class free lists and are reused
+// by subsequent allocations, so fragmentation stays bounded no matter how
+// long the insert/remove churn runs. Blocks themselves are never returned
+// to the heap - the arena high-water mark is the cost of using it.
+
+struct DictArenaBlock {
+  DictArenaBlock* next;
+};
+
+#define _DICT_ARENA_BINS  16  // size classes 8, 16, ... 256K - plenty for any block size
+
+static DictArenaBlock*  dictArenaBlocks = NULL;       // all blocks ever allocated
+static uint8_t*         dictArenaTip = NULL;          // bump pointer into the newest block
+static size_t           dictArenaRemain = 0;          // bytes left in the newest block
+static void*            dictArenaBin[_DICT_ARENA_BINS];  // free lists per size class
+
+void* dict_arena_alloc(size_t size) {
+  // round the payload up to its power-of-two size class (8 bytes minimum),
+  // so a freed chunk can be reused by any request of the same class
+  size_t  payload = 8;
+  uint8_t bin = 0;
+
+  while (payload < size) {
+    payload <<= 1;
+    bin++;
+  }
+
+  // each chunk is prefixed with its size class so free() knows the bin;
+  // the prefix is pointer-sized to keep the payload aligned
+  size_t total = sizeof(size_t) + payload;
+
+  if (bin >= _DICT_ARENA_BINS || total > _DICT_ARENA_BLOCK - sizeof(DictArenaBlock)) {
+    // oversized for a block - fall back to the plain heap
+    size_t* p = (size_t*)malloc(total);
+    if (!p) return NULL;
+    *p = (size_t)-1;
+    return p + 1;
+  }
+
+  if (dictArenaBin[bin]) {  // reuse a freed chunk of this class
+    void* p = dictArenaBin[bin];
+    dictArenaBin[bin] = *(void**)p;  // the size-class prefix is still in place
+    return p;
+  }
+
+  if (dictArenaRemain < total) {  // need a fresh block
+    DictArenaBlock* b = NULL;
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
+    if (dictAllocPolicy == DICT_ALLOC_PSRAM && _dict_psram_found()) {
+      b = (DictArenaBlock*)ps_malloc(_DICT_ARENA_BLOCK);
+    }
+    if (!b) b = (DictArenaBlock*)malloc(_DICT_ARENA_BLOCK);
+    if (!b && dictAllocPolicy == DICT_ALLOC_INTERNAL_PSRAM && _dict_psram_found()) {
+      b = (DictArenaBlock*)ps_malloc(_DICT_ARENA_BLOCK);
+    }
+#else
+    b = (DictArenaBlock*)malloc(_DICT_ARENA_BLOCK);
+#endif
+    if (!b) return NULL;
+
+    b->next = dictArenaBlocks;
+    dictArenaBlocks = b;
+    dictArenaTip = (uint8_t*)b + sizeof(DictArenaBlock);
+    dictArenaRemain = _DICT_ARENA_BLOCK - sizeof(DictArenaBlock);
+  }
+
+  size_t* p = (size_t*)dictArenaTip;
+  dictArenaTip += total;
+  dictArenaRemain -= total;
+  *p = bin;
+  return p + 1;
+}
+
+// size-class footprint of one allocation (pointer-sized prefix plus the
+// rounded payload) - used by Dictionary::reserve to estimate how many
+// bytes a bulk load will carve out of the arena
+static size_t dict_arena_chunk(size_t size) {
+  size_t payload = 8;
+  while (payload < size) payload <<= 1;
+  return sizeof(size_t) + payload;
+}
+
+// Ensure the bump region has at least this many bytes left, allocating
+// one (possibly oversized) block up front so a bulk load never stops to
+// grab another block mid-flight. The unused tail of the previous block
+// is abandoned (chunks already on the free lists are unaffected), so
+// this is meant to be called once before a load, not per entry.
+bool dict_arena_reserve(size_t bytes) {
+  if (dictArenaRemain >= bytes) return true;
+
+  size_t body = _DICT_ARENA_BLOCK - sizeof(DictArenaBlock);
+  if (bytes > body) body = bytes;
+  size_t total = sizeof(DictArenaBlock) + body;
+
+  DictArenaBlock* b = NULL;
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
+  if (dictAllocPolicy == DICT_ALLOC_PSRAM && _dict_psram_found()) {
+    b = (DictArenaBlock*)ps_malloc(total);
+  }
+  if (!b) b = (DictArenaBlock*)malloc(total);
+  if (!b && dictAllocPolicy == DICT_ALLOC_INTERNAL_PSRAM && _dict_psram_found()) {
+    b = (DictArenaBlock*)ps_malloc(total);
+  }
+#else
+  b = (DictArenaBlock*)malloc(total);
+#endif
+  if (!b) return false;
+
+  b->next = dictArenaBlocks;
+  dictArenaBlocks = b;
+  dictArenaTip = (uint8_t*)b + sizeof(DictArenaBlock);
+  dictArenaRemain = body;
+  return true;
+}
+
+void dict_arena_free(void* p) {
+  if (p == NULL) return;
+
+  size_t* chunk = (size_t*)p - 1;
+
+  if (*chunk == (size_t)-1) {  // oversized chunk lives on the plain heap
+    free(chunk);
+    return;
+  }
+
+  // push onto the free list of its size class (the next pointer is stored
+  // in the payload itself - every class is at least pointer-sized)
+  *(void**)p = dictArenaBin[*chunk];
+  dictArenaBin[*chunk] = p;
+}
+
+#endif // _DICT_ARENA
+
+
 int8_t node::create(const char* aKey, _DICT_KEY_TYPE aKeySize, const char* aVal, _DICT_VAL_TYPE aValSize, node* aLeft, node* aRight) {
 
   size_t  vsize_final;
@@ -13,38 +153,55 @@ int8_t node::create(const char* aKey, _DICT_KEY_TYPE aKeySize, const char* aVal,
   ksize = aKeySize;
 
   // Now we will try to allocate memory to both char arrays
-  keybuf = NULL;
-#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
-  if (psramFound()) {
-    keybuf = (char*)ps_malloc(ks + _DICT_EXTRA);
+  // (strings short enough for the inline buffers need no allocation at all)
+#ifdef _DICT_SSO
+  if (!keyIsInline()) {
+    keybuf = (char*)_dict_malloc(ks + _DICT_EXTRA);
+    if (!keybuf) return NODEARRAY_MEM;
   }
-#endif
-  if (!keybuf)
-    keybuf = (char*)malloc(ks + _DICT_EXTRA);
+
+  if (!valIsInline()) {
+    valbuf = (char*)_dict_malloc(vsize_final);
+    if (!valbuf) {
+      if (!keyIsInline()) _dict_free(keybuf);
+      return NODEARRAY_MEM;
+    }
+  }
+#else
+  keybuf = (char*)_dict_malloc(ks + _DICT_EXTRA);
 
   if (!keybuf) return NODEARRAY_MEM;
 
-  valbuf = NULL;
-#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
-  if (psramFound()) {
-    valbuf = (char*)ps_malloc(vsize_final);
-  }
-#endif
-  if (!valbuf)
-    valbuf = (char*)malloc(vsize_final);
+  valbuf = (char*)_dict_malloc(vsize_final);
 
   if (!valbuf) {
-    free(keybuf);
+    _dict_free(keybuf);
     return NODEARRAY_MEM;
   }
+#endif
 
   // Success - we have space for both strings
-  memset(keybuf, 0, ks);
-  memcpy(keybuf, aKey, aKeySize);
-  memcpy(valbuf, aVal, aValSize);
+  memset(keyptr(), 0, ks);
+  memcpy(keyptr(), aKey, aKeySize);
+  memcpy(valptr(), aVal, aValSize);
+#if _DICT_EXTRA != 0
+  // terminate at creation so read paths never have to write into the node
+  keyptr()[ksize] = 0;
+  valptr()[vsize] = 0;
+#endif
 
+#ifdef _DICT_ENGINE_HASH
+  // the hash engine keeps no child links - the table slot refers to us
+  (void) aLeft;
+  (void) aRight;
+#else
   left = aLeft;
   right = aRight;
+#endif
+
+#ifdef _DICT_BALANCED
+  hgt = 1;  // a freshly created node is always a leaf
+#endif
 
 #ifdef _LIBDEBUG_
   Serial.print("NODE-CREATE: created a node:\n");
@@ -57,10 +214,33 @@ int8_t node::create(const char* aKey, _DICT_KEY_TYPE aKeySize, const char* aVal,
 
 int8_t node::updateValue(const char* aVal, _DICT_VAL_TYPE aValSize) {
   if ( aValSize > _DICT_VALLEN ) return NODEARRAY_ERR;
-  
+
+#ifdef _DICT_SSO
+  if ( aValSize + _DICT_EXTRA <= _DICT_SSO_VAL ) { // new value fits inline in the node
+    if ( !valIsInline() && valbuf ) _dict_free(valbuf);
+    vsize = aValSize;
+    memcpy(valinl, aVal, aValSize);
+#if _DICT_EXTRA != 0
+    valinl[vsize] = 0;
+#endif
+
+#ifdef _LIBDEBUG_
+    Serial.printf("NODE-UPDATEVALUE: updated inline value for key = %d\n", (uint32_t)key());
+    printNode();
+#endif
+
+    return NODEARRAY_OK;
+  }
+  // the new value needs a heap buffer; if the current one is inline the
+  // in-place check below can never pass (inline implies vsize < aValSize)
+#endif
+
   if (aValSize <= vsize) { // new string fits into the old one - will just update
     memcpy(valbuf, aVal, aValSize);
     vsize = aValSize;
+#if _DICT_EXTRA != 0
+    valbuf[vsize] = 0;
+#endif
 
 #ifdef _LIBDEBUG_
     Serial.printf("NODE-UPDATEVALUE: updated value for key = %d\n", (uint32_t)keybuf);
@@ -70,14 +250,7 @@ int8_t node::updateValue(const char* aVal, _DICT_VAL_TYPE aValSize) {
     return NODEARRAY_OK;
   }
 
-  char* temp = NULL;
-#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
-  if (psramFound()) {
-    temp = (char*)ps_malloc(aValSize + _DICT_EXTRA);
-  }
-#endif
-  if (!temp)
-    temp = (char*)malloc(aValSize + _DICT_EXTRA);
+  char* temp = (char*)_dict_malloc(aValSize + _DICT_EXTRA);
 
   if (!temp) { // no memory
     return NODEARRAY_MEM;
@@ -85,12 +258,19 @@ int8_t node::updateValue(const char* aVal, _DICT_VAL_TYPE aValSize) {
 
   // ok - we have enough space for the new value, lets copy the string there and delete the old one.
 
-  if ( valbuf ) free(valbuf);
+#ifdef _DICT_SSO
+  if ( !valIsInline() && valbuf ) _dict_free(valbuf);
+#else
+  if ( valbuf ) _dict_free(valbuf);
+#endif
   valbuf = temp;
 
   vsize = aValSize;
   memcpy(valbuf, aVal, vsize);
-  
+#if _DICT_EXTRA != 0
+  valbuf[vsize] = 0;
+#endif
+
 #ifdef _LIBDEBUG_
   Serial.printf("NODE-UPDATEVALUE: replaced value for key = %d\n", (uint32_t)key());
   printNode();
@@ -105,9 +285,32 @@ int8_t node::updateKey(const char* aKey, _DICT_KEY_TYPE aKeySize) {
 
   _DICT_KEY_TYPE ks = aKeySize < sizeof(uintNN_t) ? sizeof(uintNN_t) : aKeySize;
 
+#ifdef _DICT_SSO
+  if ( ks + _DICT_EXTRA <= _DICT_SSO_KEY ) { // new key fits inline in the node
+    if ( !keyIsInline() && keybuf ) _dict_free(keybuf);
+    ksize = aKeySize;
+    memset(keyinl, 0, ks);
+    memcpy(keyinl, aKey, aKeySize);
+#if _DICT_EXTRA != 0
+    keyinl[ksize] = 0;
+#endif
+
+#ifdef _LIBDEBUG_
+    Serial.printf("NODE-UPDATEKEY: updated inline key\n");
+    printNode();
+#endif
+
+    return NODEARRAY_OK;
+  }
+#endif
+
   if (ks < ksize) { // new string fits into the old one - will just update
+    memset(keybuf, 0, ks);  // keys shorter than uintNN_t must stay zero-padded for key()
     memcpy(keybuf, aKey, aKeySize);
     ksize = aKeySize;
+#if _DICT_EXTRA != 0
+    keybuf[ksize] = 0;
+#endif
     
 #ifdef _LIBDEBUG_
     Serial.printf("NODE-UPDATEKEY: updated key = %d\n", (uint32_t)keybuf);
@@ -117,14 +320,7 @@ int8_t node::updateKey(const char* aKey, _DICT_KEY_TYPE aKeySize) {
     return NODEARRAY_OK;
   }
   
-  char* temp = NULL;
-#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
-  if (psramFound()) {
-    temp = (char*)ps_malloc(ks + _DICT_EXTRA);
-  }
-#endif
-  if (!temp)
-    temp = (char*)malloc(ks + _DICT_EXTRA);
+  char* temp = (char*)_dict_malloc(ks + _DICT_EXTRA);
 
   if (!temp) { // no memory, will copy as much as we can, and return an error
 
@@ -138,11 +334,19 @@ int8_t node::updateKey(const char* aKey, _DICT_KEY_TYPE aKeySize) {
 
   // ok - we have enough space for the new value, lets copy the string there and delete the old one.
 
-  if ( keybuf ) free(keybuf);
+#ifdef _DICT_SSO
+  if ( !keyIsInline() && keybuf ) _dict_free(keybuf);
+#else
+  if ( keybuf ) _dict_free(keybuf);
+#endif
   keybuf = temp;
 
   ksize = aKeySize;
+  memset(keybuf, 0, ks);  // keys shorter than uintNN_t must stay zero-padded for key()
   memcpy(keybuf, aKey, ksize);
+#if _DICT_EXTRA != 0
+  keybuf[ksize] = 0;
+#endif
   
 #ifdef _LIBDEBUG_
   Serial.printf("NODE-UPDATEKEY: replaced keybuf = %d\n", (uint32_t)keybuf);
@@ -158,13 +362,15 @@ void node::printNode() {
   Serial.println("node:");
   Serial.printf("\tkeyNN   = %u\n", key());
   Serial.printf("\tkey  = ");
-  for (int i=0; i<ksize; i++) Serial.printf("%02x", keybuf[i]); 
-  Serial.printf(" (%d) (%u)\n", ksize, (uint32_t)keybuf);
+  for (int i=0; i<ksize; i++) Serial.printf("%02x", keyptr()[i]); 
+  Serial.printf(" (%d) (%u)\n", ksize, (uint32_t)keyptr());
   Serial.printf("\tval  = ");
-  for (int i=0; i<vsize; i++) Serial.printf("%02x", valbuf[i]); 
-  Serial.printf(" (%d) (%u)\n", vsize, (uint32_t)valbuf);
+  for (int i=0; i<vsize; i++) Serial.printf("%02x", valptr()[i]); 
+  Serial.printf(" (%d) (%u)\n", vsize, (uint32_t)valptr());
+#ifndef _DICT_ENGINE_HASH
   Serial.printf("\tLeft n  = %u\n", (uint32_t)left);
   Serial.printf("\tRight n = %u\n", (uint32_t)right);
+#endif
 }
 #endif
 
@@ -180,6 +386,10 @@ NodeArray::NodeArray(size_t init_size) {
   initialSize = init_size;
   contents = NULL;
 
+#ifdef _DICT_STATS
+  resizes = 0;
+#endif
+
   // Let's not allocate memory in the constructor and delegate it to the
   // resize method, that could return something.
 
@@ -187,7 +397,12 @@ NodeArray::NodeArray(size_t init_size) {
 
 // clear the queue (destructor).
 NodeArray::~NodeArray() {
-  free(contents); // deallocate the array of the queue.
+  clear();
+}
+
+// drop all items and release the storage (back to post-constructor state).
+void NodeArray::clear() {
+  _dict_free(contents); // deallocate the array of the queue.
 
   contents = NULL; // set queue's array pointer to nowhere.
 
@@ -203,14 +418,7 @@ int8_t NodeArray::resize(const size_t s) {
   //    exit ("QUEUE: error due to undesirable size for queue size.");
 
   // allocate enough memory for the temporary array.
-  node** temp = NULL;
-#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
-  if (psramFound()) {
-    temp = (node**)ps_malloc(sizeof(node*) * s);
-  }
-#endif
-  if (!temp)
-    temp = (node**)malloc(sizeof(node*) * s);
+  node** temp = (node**)_dict_malloc(sizeof(node*) * s);
 
   // if there is a memory allocation error.
   if (temp == NULL) return NODEARRAY_MEM;
@@ -221,7 +429,7 @@ int8_t NodeArray::resize(const size_t s) {
     temp[i] = contents[i];
 
   // deallocate the old array of the queue.
-  free(contents);
+  _dict_free(contents);
 
   // copy the pointer of the new queue.
   contents = temp;
@@ -231,18 +439,33 @@ int8_t NodeArray::resize(const size_t s) {
 
   // set the new size of the queue.
   size = s;
+
+#ifdef _DICT_STATS
+  resizes++;
+#endif
   return NODEARRAY_OK;
 }
 
+// grow the backing array to hold at least s items in one reallocation;
+// a no-op when it is already big enough (the array never shrinks).
+int8_t NodeArray::reserve(const size_t s) {
+  if (s <= size) return NODEARRAY_OK;
+  return resize(s);
+}
+
 // add an item to the queue.
 int8_t NodeArray::append(const node* i) {
   // check if the queue is full.
   if (isFull()) {
-    int8_t rc = resize(size + initialSize);
+    // grow geometrically: filling the array from empty costs O(log n)
+    // reallocations (and O(n) total pointer copies) instead of the O(n)
+    // reallocations / O(n^2) copies of fixed-increment growth
+    int8_t rc = resize(size ? size * 2 : initialSize);
     if (rc) return rc;
   }
 
-  // store the item to the array.
+  // store the item to the array and remember its slot for O(1) removal.
+  ((node*)i)->qidx = items;
   contents[tail++] = (node*)i;
 
   // increase the items.
@@ -266,27 +489,19 @@ void NodeArray::remove(const node* i) {
   if (isEmpty()) return;
   //    exit ("QUEUE: can't pop item from queue: queue is empty.");
 
-  if (items > 1) {
-    int8_t found = 0;
-    size_t index = 0;
-
-    for (size_t j = 0; j < items; j++) {
-      if (i == contents[j]) {
-        index = j;
-        found = 1;
-        break;
-      }
-    }
+  // the node remembers its own slot, so no scan is needed: move the last
+  // node into the vacated slot (positional order is not contractual)
+  size_t index = i->qidx;
 
-    if ( !found ) return;  // how?
+  if (index >= items || contents[index] != i) return;  // how?
 
 #ifdef _LIBDEBUG_
-    Serial.printf("NODEARRAY-REMOVE: found index: %d\n", index);
+  Serial.printf("NODEARRAY-REMOVE: found index: %d\n", index);
 #endif
 
-    for (size_t j = index; j < items - 1; j++) {
-      contents[j] = contents[j + 1];
-    }
+  if (index < items - 1) {
+    contents[index] = contents[items - 1];
+    contents[index]->qidx = index;
   }
   tail--;
   items--;
@@ -329,15 +544,41 @@ size_t NodeArray::count() const {
 
 
 // ==== CONSTRUCTOR / DESTRUCTOR ==================================
-Dictionary::Dictionary(size_t init_size) {
+Dictionary::Dictionary(size_t init_size, uint8_t alloc_policy) {
   iRoot = NULL;
 
+#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
+  iAllocPolicy = alloc_policy;
+  applyAllocPolicy();   // the constructor's own allocations honor it too
+#else
+  (void)alloc_policy;
+#endif
+
+#ifdef _DICT_ENGINE_HASH
+  // like the NodeArray, the slot table is only allocated on first insert
+  iTable = NULL;
+  iCap = 0;
+#endif
+
   // This is unlikely to fail as practically no memory is allocated by the NodeArray
   // All memory allocation is delegated to the first append
   Q = new NodeArray(init_size);
   initSize = init_size;
+  iFP = 0;
+  iSize = 0;
+
+#ifdef _DICT_STATS
+  iSearchCmps = 0;
+  iInsertCmps = 0;
+#ifdef _DICT_ENGINE_HASH
+  iRehashes = 0;
+#endif
+#endif
 
 #ifdef _DICT_COMPRESS
+  iPlainSize = 0;
+  iKeyPlain = 0;
+  iValPlain = 0;
   // This however is a problem - need to think about a safer way
   iKeyTemp = (char*) malloc(sizeof(char) * (_DICT_KEYLEN + 1));
   iValTemp = (char*) malloc(sizeof(char) * (_DICT_VALLEN + 1));
@@ -345,15 +586,47 @@ Dictionary::Dictionary(size_t init_size) {
   iKeyTemp = NULL;
   iValTemp = NULL;
 #endif
+
+#if defined(_DICT_COMPRESS) && defined(_DICT_CACHE)
+  memset(iCache, 0, sizeof(iCache));
+#endif
+
+#ifdef _DICT_THREADSAFE
+#if defined(ARDUINO_ARCH_ESP32)
+  iRWMutex = xSemaphoreCreateMutex();
+  // the gate has to be a plain binary semaphore, not a mutex: the last
+  // reader of a group may give it back from a different task than the
+  // first reader that took it
+  iRWGate = xSemaphoreCreateBinary();
+  xSemaphoreGive(iRWGate);
+#else
+  iWriter = false;
+#endif
+  iReaders = 0;
+#endif
 }
 
 Dictionary::~Dictionary() {
   destroy();
   delete Q;
+#ifdef _DICT_ENGINE_HASH
+  if (iTable) _dict_free(iTable);
+#endif
 #ifdef _DICT_COMPRESS
   free(iKeyTemp); iKeyTemp = NULL;
   free(iValTemp); iValTemp = NULL;
 #endif
+
+#if defined(_DICT_COMPRESS) && defined(_DICT_CACHE)
+  for (int i = 0; i < _DICT_CACHE_SIZE; i++) {
+    if (iCache[i].val) _dict_free(iCache[i].val);
+  }
+#endif
+
+#if defined(_DICT_THREADSAFE) && defined(ARDUINO_ARCH_ESP32)
+  vSemaphoreDelete(iRWMutex);
+  vSemaphoreDelete(iRWGate);
+#endif
 }
 
 
@@ -363,18 +636,18 @@ Dictionary::~Dictionary() {
 // ===== INSERTS =====================================================
 
 int8_t Dictionary::insert(const char* keystr, const char* valstr) {
+  _DICT_WLOCK;
+  applyAllocPolicy();
   // TODO: decide if to check for length here
   iKeyLen = strnlen(keystr, _DICT_KEYLEN + 1);
-#ifdef _DICT_COMPRESS
   int8_t rc;
-#endif
 
   if ( iKeyLen == 0 || iKeyLen > _DICT_KEYLEN ) return DICTIONARY_ERR;
   if ( (iValLen = strnlen(valstr, _DICT_VALLEN + 1)) > _DICT_VALLEN ) return DICTIONARY_ERR;
 
 #ifdef _DICT_COMPRESS
-  if ( (rc = compressKey(keystr)) ) return rc;
-  if ( (rc = compressValue(valstr)) ) return rc;
+  if ( (rc = compressKey(keystr, iKeyLen)) ) return rc;
+  if ( (rc = compressValue(valstr, iValLen)) ) return rc;
 #else
   iKeyTemp = (char*) keystr;
   iValTemp = (char*) valstr;
@@ -382,105 +655,361 @@ int8_t Dictionary::insert(const char* keystr, const char* valstr) {
 
   uintNN_t key = crc(iKeyTemp, iKeyLen);
 
-  if (iRoot != NULL)
-    return insert(key, iKeyTemp, iKeyLen, iValTemp, iValLen, iRoot);
-  else {
-    int8_t rc;
-
-    iRoot = new node;
-    if (!iRoot) return DICTIONARY_MEM;
-    rc = iRoot->create(iKeyTemp, iKeyLen, iValTemp, iValLen, NULL, NULL);
+  // through a local: a packed iRoot cannot bind to the node*& parameter
+  node* root = iRoot;
+  rc = insert(key, iKeyTemp, iKeyLen, iValTemp, iValLen, root);
+  iRoot = root;
+  return rc;
+}
 
-#ifdef _LIBDEBUG_
-    Serial.printf("DICT-insert: creating root entry. rc = %d\n", rc);
+// Pre-size the storage for an anticipated total number of entries. The
+// node array grows to its final size in one reallocation, and with the
+// hash engine the slot table is rehashed to its final capacity up front,
+// so the bulk load that follows never pauses to copy what it has already
+// placed. With _DICT_ARENA the optional avgKeyLen/avgValLen hints also
+// pre-charge the arena with one block sized for the whole load (an
+// estimate: _DICT_SSO builds store short strings inline and will not
+// consume their share). On a plain heap the hints are ignored - each
+// node and string is still an individual malloc and cannot be prepaid.
+int8_t Dictionary::reserve(size_t entries, size_t avgKeyLen, size_t avgValLen) {
+    _DICT_WLOCK;
+    applyAllocPolicy();
+
+    if (entries == 0) return DICTIONARY_OK;
+    if (!Q || Q->reserve(entries) != NODEARRAY_OK) return DICTIONARY_MEM;
+
+#ifdef _DICT_ENGINE_HASH
+    // grow the probe table past its 75% load ceiling now - a mid-load
+    // rehash would re-place every entry inserted so far
+    if (iCap * 3 < entries * 4) {
+        int8_t rc = tableRehash(entries);
+        if (rc) return rc;
+    }
 #endif
 
-    if (rc) {
-      delete iRoot;
-      return rc;
+#ifdef _DICT_ARENA
+    if (avgKeyLen || avgValLen) {
+        // per-entry cost in arena terms: the node plus the two strings,
+        // each rounded up to its power-of-two size class
+        size_t kl = (avgKeyLen < sizeof(uintNN_t) ? sizeof(uintNN_t) : avgKeyLen) + _DICT_EXTRA;
+        size_t per = dict_arena_chunk(sizeof(node))
+                   + dict_arena_chunk(kl)
+                   + dict_arena_chunk(avgValLen + _DICT_EXTRA);
+        if (!dict_arena_reserve(per * entries)) return DICTIONARY_MEM;
     }
-    rc = Q->append(iRoot);
-    if (rc) {
-      delete iRoot;
-      return rc;
+#else
+    (void)avgKeyLen;
+    (void)avgValLen;
+#endif
+
+    return DICTIONARY_OK;
+}
+
+
+// Bulk construction: appends all pairs without touching the tree, then
+// sorts once and links a perfectly balanced tree bottom-up in O(n log n)
+// for the sort and O(n) for the build - much cheaper than n root-to-leaf
+// insert descents. Pairs with keys that already exist (in the input or
+// in the dictionary) replace the earlier value, same as insert().
+int8_t Dictionary::build(const char* const* keys, const char* const* vals, size_t n) {
+    _DICT_WLOCK;
+    applyAllocPolicy();
+    int8_t rc = DICTIONARY_OK;
+
+    // the final entry count is known - grow the node array once (best
+    // effort: append falls back to incremental growth)
+    if (n) Q->reserve(count() + n);
+
+    for (size_t i = 0; i < n; i++) {
+        iKeyLen = strnlen(keys[i], _DICT_KEYLEN + 1);
+        if ( iKeyLen == 0 || iKeyLen > _DICT_KEYLEN ) { rc = DICTIONARY_ERR; break; }
+        if ( (iValLen = strnlen(vals[i], _DICT_VALLEN + 1)) > _DICT_VALLEN ) { rc = DICTIONARY_ERR; break; }
+
+#ifdef _DICT_COMPRESS
+        if ( (rc = compressKey(keys[i], iKeyLen)) ) break;
+        if ( (rc = compressValue(vals[i], iValLen)) ) break;
+#else
+        iKeyTemp = (char*) keys[i];
+        iValTemp = (char*) vals[i];
+#endif
+
+        rc = appendNode(crc(iKeyTemp, iKeyLen), iKeyTemp, iKeyLen, iValTemp, iValLen);
+        if (rc) break;
     }
-  }
-  return DICTIONARY_OK;
+
+    // link everything appended so far even on error, so the tree and the
+    // node array stay consistent
+    int8_t rrc = rebuild();
+    return rc ? rc : rrc;
 }
 
 
 // ==== SEARCHES AND LOOKUPS ===============================================
-String Dictionary::search(const char* keystr) {
-    iKeyLen = strnlen(keystr, _DICT_KEYLEN + 1);
+// The lookup path is const and keeps all its scratch on the stack, so any
+// number of tasks may read the same dictionary concurrently without locks
+// (unless _DICT_CACHE is enabled - the LRU bookkeeping mutates shared
+// state; see README).
+String Dictionary::search(const char* keystr) const {
+    _DICT_RLOCK;
+    node* p = lookupNode(keystr);
+
+    if (p) {
+        char vb[_DICT_VALLEN + 1];
+        _DICT_VAL_TYPE vl;
+        return String(valueOf(p, vb, vl));
+    }
+    return String("");
+}
+
+// Find the node of a key without touching any shared state.
+node* Dictionary::lookupNode(const char* keystr) const {
+    size_t keylen = strnlen(keystr, _DICT_KEYLEN + 1);
+
+    if (keylen == 0 || keylen > _DICT_KEYLEN) return NULL;
+
 #ifdef _DICT_COMPRESS
-    int8_t rc;
+    char kb[_DICT_KEYLEN + 1];
+    _DICT_KEY_TYPE klen;
+
+    if ( compressKeyTo(keystr, keylen, kb, klen) ) return NULL;
+    return search(crc(kb, klen), iRoot, kb, klen);
+#else
+    return search(crc(keystr, keylen), iRoot, keystr, keylen);
 #endif
+}
 
-    if (iKeyLen != 0 && iKeyLen <= _DICT_KEYLEN) {
-#ifdef _DICT_COMPRESS
-        if ( (rc = compressKey(keystr)) ) return String("");
+// Hand out the value of a node: directly from the node when uncompressed
+// (values are stored null-terminated), from the LRU cache or decompressed
+// into the caller's buffer otherwise.
+const char* Dictionary::valueOf(node* p, char* aBuf, _DICT_VAL_TYPE& aLen) const {
+#if defined(_DICT_COMPRESS) && defined(_DICT_CACHE)
+    (void)aBuf;
+    return cachedValue(p, aLen);
+#elif defined(_DICT_COMPRESS)
+    aLen = decompressValueTo(p->valptr(), p->vsize, aBuf);
+    return aBuf;
 #else
-        iKeyTemp = (char*) keystr;
+    (void)aBuf;
+    aLen = p->vsize;
+    return p->valptr();
 #endif
-        uintNN_t key = crc(iKeyTemp, iKeyLen);
+}
 
-        node* p = search(key, iRoot, iKeyTemp, iKeyLen);
-        if (p) {
+// Non-allocating lookup: returns a pointer to the internal value string
+// (or NULL if the key is not present) and optionally its length, so hot
+// paths can read values with zero heap operations. The pointer belongs to
+// the dictionary and is only valid until the next operation on it - do
+// not free it and do not hold on to it.
+const char* Dictionary::get(const char* keystr, size_t* vallen) {
 #ifdef _DICT_COMPRESS
-            decompressValue(p->valbuf, p->vsize);
+    // the compressed variant decompresses into the shared iValTemp buffer,
+    // so it has to exclude other readers, not just writers
+    _DICT_WLOCK;
 #else
-            iValTemp = p->valbuf;
-            iValTemp[p->vsize] = 0;
+    _DICT_RLOCK;
+#endif
+    node* p = lookupNode(keystr);
+
+    if (!p) return NULL;
+
+#if defined(_DICT_COMPRESS) && defined(_DICT_CACHE)
+    char* v = cachedValue(p, iValLen);
+    if (vallen) *vallen = iValLen;
+    return v;
+#elif defined(_DICT_COMPRESS)
+    iValLen = decompressValueTo(p->valptr(), p->vsize, iValTemp);
+    if (vallen) *vallen = iValLen;
+    return iValTemp;
+#else
+    if (vallen) *vallen = p->vsize;
+    return p->valptr();
 #endif
-            return String(iValTemp);
-        }
-    }
-    return String("");
 }
 
-String Dictionary::key(size_t i) {
+
+String Dictionary::key(size_t i) const {
+  _DICT_RLOCK;
   if (Q) {
     node* p = (*Q)[i];
     if (p) {
 #ifdef _DICT_COMPRESS
-        decompressKey(p->keybuf, p->ksize);
+        char kb[_DICT_KEYLEN + 1];
+        decompressKeyTo(p->keyptr(), p->ksize, kb);
+        return String(kb);
 #else
-        iKeyTemp = p->keybuf;
-        iKeyTemp[p->ksize] = 0;
+        return String(p->keyptr());  // keys are stored null-terminated
 #endif
-        return String(iKeyTemp);
     }
   }
   return String();
 }
 
-String Dictionary::value(size_t i) {
+String Dictionary::value(size_t i) const {
+    _DICT_RLOCK;
     if (Q) {
         node* p = (*Q)[i];
         if (p) {
 #ifdef _LIBDEBUG_
     Serial.printf("Dictionary::value:\n");
-    Serial.printf("\tFound ptr = %u (%u:%d)\n", (uint32_t)p, (uint32_t)p->valbuf, p->vsize);
+    Serial.printf("\tFound ptr = %u (%u:%d)\n", (uint32_t)p, (uint32_t)p->valptr(), p->vsize);
 #endif
+            char vb[_DICT_VALLEN + 1];
+            _DICT_VAL_TYPE vl;
+            return String(valueOf(p, vb, vl));
+        }
+    }
+    return String();
+}
+
+
+// Full-scan workhorse: hands the callback plain-text pointers straight
+// off the node (or off a per-entry stack buffer under compression), so a
+// complete walk costs one decompression per entry and zero String churn.
+template<typename F> size_t Dictionary::forEach(F cb) const {
+    _DICT_RLOCK;
+    size_t ct = count();
+
+    for (size_t i = 0; i < ct; i++) {
+        node* p = (*Q)[i];
 #ifdef _DICT_COMPRESS
-            decompressValue(p->valbuf, p->vsize);
+        char kb[_DICT_KEYLEN + 1];
+        char vb[_DICT_VALLEN + 1];
+        _DICT_KEY_TYPE kl = decompressKeyTo(p->keyptr(), p->ksize, kb);
+        _DICT_VAL_TYPE vl = decompressValueTo(p->valptr(), p->vsize, vb);
+
+        if ( !cb((const char*)kb, kl, (const char*)vb, vl) ) return i + 1;
 #else
-            iValTemp = p->valbuf;
-            iValTemp[p->vsize] = 0;
+        if ( !cb((const char*)p->keyptr(), p->ksize, (const char*)p->valptr(), p->vsize) ) return i + 1;
 #endif
-            return String(iValTemp);
+    }
+    return ct;
+}
+
+
+// Prefix-restricted scan. A prefix is NOT a contiguous range of this
+// tree (the integer key compares in native byte order and ties break
+// length-first), so a wholesale subtree descent is not possible - but the
+// integer key IS the first bytes of the stored key, which allows most
+// entries to be rejected on one integer compare:
+//  - plain keys, _DICT_BALANCED, prefix >= sizeof(uintNN_t): pruned tree
+//    descent visiting only the nodes whose integer key equals the
+//    prefix's - O(log n + candidates)
+//  - plain keys otherwise: flat scan over the node array with a masked
+//    integer compare per entry - O(n), but no byte-by-byte work and no
+//    String/decompression for the non-matching entries
+//  - compressed or hashed keys (_DICT_COMPRESS, _DICT_HASH_FNV,
+//    _DICT_ENGINE_HASH): stored bytes carry no usable ordering - filtered
+//    forEach() walk, one decompression per entry
+template<typename F> size_t Dictionary::forEachPrefix(const char* prefix, F cb) const {
+    _DICT_RLOCK;
+    size_t plen = strnlen(prefix, _DICT_KEYLEN + 1);
+    size_t matches = 0;
+
+    if (plen == 0 || plen > _DICT_KEYLEN) return 0;
+
+#if !defined(_DICT_COMPRESS) && !defined(_DICT_HASH_FNV) && !defined(_DICT_ENGINE_HASH)
+    uintNN_t pk = crc(prefix, plen);  // first bytes of the prefix
+
+#ifdef _DICT_BALANCED
+    if (plen >= sizeof(uintNN_t)) {
+        // every match carries exactly pk as its integer key: in-order
+        // descent pruned to the equal-key band; the AVL tree is never
+        // deeper than _DICT_MAX_DEPTH, so the stack always fits
+        node* stk[_DICT_MAX_DEPTH];
+        uint8_t sp = 0;
+        node* cur = iRoot;
+
+        while (cur || sp) {
+            while (cur) {
+                if (cur->key() > pk) cur = cur->left;
+                else if (cur->key() < pk) cur = cur->right;
+                else {
+                    stk[sp++] = cur;    // equal band can continue on both sides
+                    cur = cur->left;
+                }
+            }
+            if (!sp) break;
+            cur = stk[--sp];
+            if (cur->ksize >= plen && memcmp(cur->keyptr(), prefix, plen) == 0) {
+                matches++;
+                if ( !cb((const char*)cur->keyptr(), cur->ksize, (const char*)cur->valptr(), cur->vsize) ) return matches;
+            }
+            cur = cur->right;
         }
+        return matches;
     }
-    return String();
+#endif
+    // flat scan: reject on the first min(plen, sizeof(uintNN_t)) bytes
+    // with one integer operation before touching the key bytes
+    uintNN_t mask = 0;
+    memset(&mask, 0xFF, plen < sizeof(uintNN_t) ? plen : sizeof(uintNN_t));
+
+    size_t ct = count();
+    for (size_t i = 0; i < ct; i++) {
+        node* p = (*Q)[i];
+
+        if ( (p->key() ^ pk) & mask ) continue;
+        if ( p->ksize < plen || memcmp(p->keyptr(), prefix, plen) ) continue;
+        matches++;
+        if ( !cb((const char*)p->keyptr(), p->ksize, (const char*)p->valptr(), p->vsize) ) return matches;
+    }
+#else
+    forEach([&](const char* k, _DICT_KEY_TYPE kl, const char* v, _DICT_VAL_TYPE vl) {
+        if ( (size_t)kl < plen || memcmp(k, prefix, plen) ) return true;
+        matches++;
+        return (bool)cb(k, kl, v, vl);
+    });
+#endif
+    return matches;
+}
+
+
+// Lexicographic range scan: visits every entry with lo <= key <= hi in
+// strcmp() order terms. The tree's internal ordering (native-byte-order
+// integers, length-first ties) does not match strcmp, so no subtree can
+// be skipped - this is a filtered full walk, one decompression per entry
+// at most, no String churn.
+template<typename F> size_t Dictionary::forEachRange(const char* lo, const char* hi, F cb) const {
+    _DICT_RLOCK;
+    size_t matches = 0;
+
+    forEach([&](const char* k, _DICT_KEY_TYPE kl, const char* v, _DICT_VAL_TYPE vl) {
+        if ( strcmp(k, lo) < 0 || strcmp(k, hi) > 0 ) return true;
+        matches++;
+        return (bool)cb(k, kl, v, vl);
+    });
+    return matches;
 }
 
 
 // ==== DELETES =====================================================
 void Dictionary::destroy() {
-    destroy_tree(iRoot);
+    _DICT_WLOCK;
+    // Q holds a pointer to every node, so a flat walk over it deletes the
+    // entire tree without recursing (a degenerate tree of a few hundred
+    // nodes is enough to overflow a small task stack)
+    size_t ct = count();
+
+    for (size_t i = 0; i < ct; i++) {
+        delete (*Q)[i]; // node destructor takes care of the key and value strings
+    }
+    cacheClear();
     iRoot = NULL;
-    delete Q;
-    Q = new NodeArray(initSize);
+    iFP = 0;
+    iSize = 0;
+#ifdef _DICT_COMPRESS
+    iPlainSize = 0;
+#endif
+#ifdef _DICT_ENGINE_HASH
+    if (iTable) {
+        _dict_free(iTable);
+        iTable = NULL;
+        iCap = 0;
+    }
+#endif
+    // keep the Q pointer itself stable (count() may be polled concurrently
+    // in _DICT_THREADSAFE builds); clear() releases all the node storage
+    Q->clear();
 }
 
 int8_t Dictionary::remove(const String& keystr) {
@@ -488,6 +1017,8 @@ int8_t Dictionary::remove(const String& keystr) {
 }
 
 int8_t Dictionary::remove(const char* keystr) {
+    _DICT_WLOCK;
+    applyAllocPolicy();   // node deletion may reallocate key/value buffers
 #ifdef _LIBDEBUG_
     Serial.printf("Dictionary::remove: %s\n", keystr);
 #endif
@@ -498,7 +1029,7 @@ int8_t Dictionary::remove(const char* keystr) {
     if (iKeyLen > _DICT_KEYLEN) return DICTIONARY_ERR;
 
 #ifdef _DICT_COMPRESS
-    if ( (rc = compressKey(keystr)) ) return rc;
+    if ( (rc = compressKey(keystr, iKeyLen)) ) return rc;
 #else
     iKeyTemp = (char*) keystr;
 #endif
@@ -519,62 +1050,182 @@ int8_t Dictionary::remove(const char* keystr) {
 
 
 // ==== SIZES ============================================================================
+// All three queries answer from running counters: iSize tracks the stored
+// (possibly compressed) key+value bytes, iPlainSize the plain-text lengths.
+// The counters are adjusted in O(1) by every insert/update/remove, so a
+// jsize() poll before a periodic save no longer scans (and under
+// compression, decompresses) the entire dictionary.
+
 // This is the size of the Dictionary in memory (just data, not object)
-size_t Dictionary::size() {
-    size_t ct = count();
-    size_t sz = 0;
-    for (size_t i = 0; i < ct; i++) {
-        sz += (*Q)[i]->ksize;
-        sz += (*Q)[i]->vsize;
-        sz += sizeof(node);  // to account for size of the node itself
-    }
-    return sz;
+size_t Dictionary::size() const {
+    _DICT_RLOCK;
+    return iSize + count() * sizeof(node);  // to account for size of the nodes themselves
 }
 
 // This is size of JSON file to be created out of this dictionary
-size_t Dictionary::jsize() {
-    size_t ct = count();
+size_t Dictionary::jsize() const {
+    _DICT_RLOCK;
     // {"key":"value","key":"value"}\0:
     // 3 (2 brackets and 1 zero terminator) + 4 quotes, a comma and a semicolon = 6 chars)
     // minus one last comma
-    size_t sz = 2 + ct * 6;
-    for (size_t i = 0; i < ct; i++) {
-        sz += key(i).length();
-        sz += value(i).length();
-    }
-    return sz;
+#ifdef _DICT_COMPRESS
+    return 2 + count() * 6 + iPlainSize;
+#else
+    return 2 + count() * 6 + iSize;
+#endif
 }
 
 // This is size method for storing in EEPROM
-size_t Dictionary::esize() {
+size_t Dictionary::esize() const {
+    _DICT_RLOCK;
+#ifdef _DICT_COMPRESS
+    return iPlainSize + count() * 2;  // a zero terminator after every key and value
+#else
+    return iSize + count() * 2;
+#endif
+}
+
+
+#ifdef _DICT_STATS
+// ==== INSTRUMENTATION ==================================================
+// Depth is measured on demand. The hash engine reads each entry's probe
+// distance straight off the table; the tree engine re-descends from the
+// root to every node - O(n log n) for a healthy tree, which is fine for
+// a periodic telemetry poll and is exactly the case (a degenerated tree)
+// this surface exists to catch.
+DictionaryStats Dictionary::stats() const {
+    _DICT_RLOCK;
+    DictionaryStats s;
     size_t ct = count();
-    size_t sz = 0;
+    size_t maxd = 0;
+    size_t sum = 0;
+
+#ifdef _DICT_ENGINE_HASH
+    for (size_t i = 0; i < iCap; i++) {
+        if (!iTable[i].n) continue;
+        size_t d = ((i + iCap - homeSlot(iTable[i].h)) & (iCap - 1)) + 1;
 
+        sum += d;
+        if (d > maxd) maxd = d;
+    }
+#else
     for (size_t i = 0; i < ct; i++) {
-        sz += key(i).length() + 1;
-        sz += value(i).length() + 1;
+        node* p = (*Q)[i];
+        uintNN_t k = p->key();
+        node* leaf = iRoot;
+        size_t d = 0;
+
+        // same descent as search(), terminated by node identity
+        while (leaf) {
+            d++;
+            if (leaf == p) break;
+            if (k == leaf->key()) {
+                int cmpres = p->ksize != leaf->ksize ? p->ksize - leaf->ksize : memcmp(leaf->keyptr(), p->keyptr(), p->ksize);
+                leaf = cmpres < 0 ? leaf->left : leaf->right;
+            }
+            else {
+                leaf = k < leaf->key() ? leaf->left : leaf->right;
+            }
+        }
+        sum += d;
+        if (d > maxd) maxd = d;
     }
-    return sz;
+#endif
+
+    s.entries = ct;
+    s.maxDepth = maxd;
+    s.avgDepth = ct ? (float)sum / (float)ct : 0;
+    s.searchCmps = iSearchCmps;
+    s.insertCmps = iInsertCmps;
+    s.resizes = Q ? Q->resizes : 0;
+#ifdef _DICT_ENGINE_HASH
+    s.resizes += iRehashes;
+#endif
+    s.bytesAllocated = dictStatsBytes;
+    return s;
 }
 
+// Zero the cumulative counters so the next stats() reads as a delta.
+// bytesAllocated is deliberately left alone: it is shared by every
+// dictionary in the build and resetting it here would skew the others.
+void Dictionary::statsReset() {
+    _DICT_WLOCK;
+    iSearchCmps = 0;
+    iInsertCmps = 0;
+    if (Q) Q->resizes = 0;
+#ifdef _DICT_ENGINE_HASH
+    iRehashes = 0;
+#endif
+}
+#endif // _DICT_STATS
+
 
 // ==== JSON RELATED ================================================
-String Dictionary::json() {
+String Dictionary::json() const {
+    _DICT_RLOCK;
     String s;
+    size_t ct = count();
+    size_t i = 0;
 
     s.reserve(jsize());
     s = '{';
 
+    // single decompression per entry, no intermediate String objects;
+    // the buffers handed over are null-terminated plain text
+    forEach([&s, &i, ct](const char* k, _DICT_KEY_TYPE, const char* v, _DICT_VAL_TYPE vl) {
+        s += '"';
+        s += k;
+        s += "\":\"";
+        for (size_t j = 0; j < (size_t)vl; j++) {
+            if (v[j] == '"') s += '\\';
+            s += v[j];
+        }
+        s += '"';
+        if (++i < ct) s += ',';
+        return true;
+    });
+    s += '}';
+
+    return s;
+}
+
+// Streaming counterpart of json(): writes the document straight into the
+// target Stream one entry at a time, so serialization needs no contiguous
+// jsize() buffer (which may be impossible to allocate on a fragmented
+// heap). Returns the number of bytes written.
+size_t Dictionary::jsonTo(Stream& out) const {
+    _DICT_RLOCK;
     size_t ct = count();
+    size_t sz = 0;
+
+    sz += out.print('{');
     for (size_t i = 0; i < ct; i++) {
-        String vv = value(i);
-        vv.replace("\"","\\\"");
-        s += '"' + key(i) + "\":\"" + vv + '"';
-        if (i < ct - 1) s += ',';
+        node* p = (*Q)[i];
+        _DICT_VAL_TYPE vl;
+        char vb[_DICT_VALLEN + 1];
+#ifdef _DICT_COMPRESS
+        char kb[_DICT_KEYLEN + 1];
+        _DICT_KEY_TYPE kl = decompressKeyTo(p->keyptr(), p->ksize, kb);
+        const char* kp = kb;
+#else
+        const char* kp = p->keyptr();
+        _DICT_KEY_TYPE kl = p->ksize;
+#endif
+        const char* vp = valueOf(p, vb, vl);
+
+        sz += out.print('"');
+        sz += out.write((const uint8_t*)kp, kl);
+        sz += out.print("\":\"");
+        for (size_t j = 0; j < (size_t)vl; j++) {
+            if (vp[j] == '"') sz += out.print('\\');
+            sz += out.print(vp[j]);
+        }
+        sz += out.print('"');
+        if (i < ct - 1) sz += out.print(',');
     }
-    s += '}';
+    sz += out.print('}');
 
-    return s;
+    return sz;
 }
 
 int8_t Dictionary::jload(const String& json, int aNum) {
@@ -583,148 +1234,419 @@ int8_t Dictionary::jload(const String& json, int aNum) {
 }
 
 int8_t Dictionary::jload(Stream& json, int aNum) {
-    bool insideQoute = false;
-    bool nextVerbatim = false;
-    bool isValue = false;
-    bool isComment = false;
-    int p = 0;
-    int8_t rc;
-    String currentKey;
-    String currentValue;
+    JsonLoader loader(*this);
+
+    while ( json.peek() >= 0 ) {
+        int8_t rc = loader.consume((char)json.read());
+
+        if (rc < 0) return rc;                          // hard error
+        if (rc == DICTIONARY_OK) return DICTIONARY_OK;  // closing brace seen
+        if (aNum > 0 && loader.pairs() >= (size_t)aNum) return DICTIONARY_OK;
+    }
+    if (aNum > 0 && loader.pairs() < (size_t)aNum) return DICTIONARY_EOF;
+    return loader.end();
+}
+
+
+// ==== RESUMABLE JSON LOADER =======================================
+// The jload() state machine, one character at a time. consume() returns
+// DICTIONARY_AGAIN while the document is still open, DICTIONARY_OK on
+// the closing '}' (after committing any pending pair), or an error.
+
+void JsonLoader::reset() {
+    iKeyLen = 0;
+    iValLen = 0;
+    iPairs = 0;
+    iInsideQuote = false;
+    iNextVerbatim = false;
+    iIsValue = false;
+    iIsComment = false;
+}
+
+int8_t JsonLoader::feed(Stream& json, size_t aMaxChars) {
+    size_t n = 0;
 
     while ( json.peek() >= 0 ) {
-        char c = json.read();
+        int8_t rc = consume((char)json.read());
+
+        if (rc != DICTIONARY_AGAIN) return rc;  // done or error
+        if (aMaxChars && ++n >= aMaxChars) break;
+    }
+    return DICTIONARY_AGAIN;
+}
+
+int8_t JsonLoader::feed(const char* aBuf, size_t aLen) {
+    for (size_t i = 0; i < aLen; i++) {
+        int8_t rc = consume(aBuf[i]);
+
+        if (rc != DICTIONARY_AGAIN) return rc;  // done or error
+    }
+    return DICTIONARY_AGAIN;
+}
+
+// For documents without a closing brace (line format): call when the
+// transport says the document is complete. A partial pair that never saw
+// its terminator is discarded, same as jload() always did at end of
+// stream; an unterminated quote or escape is an error.
+int8_t JsonLoader::end() {
+    return ( iInsideQuote || iNextVerbatim ? DICTIONARY_EOF : DICTIONARY_OK );
+}
 
-        if ( isComment ) {
-          if ( c == '\n' ) {
-            isComment = false;
-            isValue = false;
+int8_t JsonLoader::consume(char c) {
+    if ( iIsComment ) {
+      if ( c == '\n' ) {
+        iIsComment = false;
+        iIsValue = false;
+      }
+      return DICTIONARY_AGAIN;
+    }
+    if (iNextVerbatim) {
+      iNextVerbatim = false;
+    }
+
+    //  not a comment and not a verbatim char
+    else {
+      // process all special cases: '\', '"', ':', and ','
+      if (c == '\\' ) {
+        iNextVerbatim = true;
+        return DICTIONARY_AGAIN;
+      }
+
+      if ( c == '\"' ) {
+        if (!iInsideQuote) {
+          if ( iIsValue ) {
+            if ( iValLen > 0 ) return DICTIONARY_FMT;
           }
-          continue;
-        }
-        if (nextVerbatim) {
-          nextVerbatim = false;
+          else {
+            if ( iKeyLen > 0 ) return DICTIONARY_FMT;
+          }
+          iInsideQuote = true;
+          return DICTIONARY_AGAIN;
         }
-        
-        //  not a comment and not a verbatim char
         else {
-          // process all special cases: '\', '"', ':', and ','
-          if (c == '\\' ) {
-            nextVerbatim = true;
-            continue;
-          }
+          iInsideQuote = false;
+          return DICTIONARY_AGAIN;
+        }
+      }
+
+      if (c == '\n') {
+        if ( iInsideQuote ) {
+          return DICTIONARY_QUOTE;
+        }
+        if ( iNextVerbatim ) {
+          return DICTIONARY_BCKSL;
+        }
+      }
 
-          if ( c == '\"' ) {
-            if (!insideQoute) {
-              if ( isValue ) {
-                if ( currentValue.length() > 0 ) return DICTIONARY_FMT;
-              }
-              else {
-                if ( currentKey.length() > 0 ) return DICTIONARY_FMT;
-              }
-              insideQoute = true;
-              continue;
-            }
-            else {
-              insideQoute = false;
-              continue;
-            }
-          }
-          
-          if (c == '\n') {
-            if ( insideQoute ) {
-              return DICTIONARY_QUOTE;
-            }
-            if ( nextVerbatim ) {
-              return DICTIONARY_BCKSL;
-            }
-          }
-          
 #ifdef _DICT_ASCII_ONLY
-          if ( c > 127 ) continue;  //  ignore non-ascii characters
+      if ( c > 127 ) return DICTIONARY_AGAIN;  //  ignore non-ascii characters
 #endif
-          
-          if (!insideQoute) {
-            if ( c == '#' ) {
-              isComment = true;
-              continue;
-            }
 
-            if (c == ':') {
-              if ( isValue ) {
-                return DICTIONARY_COMMA; //missing comma probably
-              }
-              isValue = true;
-              continue;
-            }
+      if (!iInsideQuote) {
+        if ( c == '#' ) {
+          iIsComment = true;
+          return DICTIONARY_AGAIN;
+        }
 
-            if ( c == '{' || c == ' ' || c == '\t'  || c == '\r' ) continue;
-            
-            if ( c == ',' || c == '\n' || c == '}') {
-              if ( isValue ) {
-                if ( currentValue.length() == 0 ) return DICTIONARY_FMT;
-                isValue = false;
-                rc = insert( currentKey, currentValue );
-                if (rc) return DICTIONARY_MEM;  // if error - exit with an error code
-                currentValue = String();
-                currentKey = String();
-                p++;
-                if (aNum > 0 && p >= aNum) break;
-              }
-              else {
-                if ( c == ',' ) return DICTIONARY_FMT;
-              }
-              continue;
-            }
+        if (c == ':') {
+          if ( iIsValue ) {
+            return DICTIONARY_COMMA; //missing comma probably
+          }
+          iIsValue = true;
+          return DICTIONARY_AGAIN;
+        }
+
+        if ( c == '{' || c == ' ' || c == '\t'  || c == '\r' ) return DICTIONARY_AGAIN;
+
+        if ( c == ',' || c == '\n' || c == '}') {
+          if ( iIsValue ) {
+            if ( iValLen == 0 ) return DICTIONARY_FMT;
+            iIsValue = false;
+            iKey[iKeyLen] = 0;
+            iVal[iValLen] = 0;
+            if ( iDict.insert(iKey, iVal) ) return DICTIONARY_MEM;
+            iKeyLen = 0;
+            iValLen = 0;
+            iPairs++;
           }
+          else {
+            if ( c == ',' ) return DICTIONARY_FMT;
+          }
+          return ( c == '}' ? DICTIONARY_OK : DICTIONARY_AGAIN );
         }
-        if (isValue) currentValue.concat(c);
-        else currentKey.concat(c);
       }
-      if (insideQoute || nextVerbatim || (aNum > 0 && p < aNum )) return DICTIONARY_EOF;
+    }
+    if (iIsValue) {
+      if ( iValLen >= _DICT_VALLEN ) return DICTIONARY_OOB;
+      iVal[iValLen++] = c;
+    }
+    else {
+      if ( iKeyLen >= _DICT_KEYLEN ) return DICTIONARY_OOB;
+      iKey[iKeyLen++] = c;
+    }
+    return DICTIONARY_AGAIN;
+}
 
-      return DICTIONARY_OK;
+
+// ==== BINARY SNAPSHOT =============================================
+// Compact binary serialization for instant startup: a small header
+// followed by length-prefixed key/value records in their stored
+// (possibly compressed) form, so load() rebuilds the dictionary without
+// any JSON re-parsing or re-compression.
+//
+// The snapshot encodes the compile-time options that shape the stored
+// bytes (_DICT_CRC width, compression algorithm), and load() refuses a
+// snapshot written by an incompatible build.
+
+// single byte describing the build options a snapshot depends on
+#define _DICT_SNAPSHOT_CFG  (uint8_t)( (_DICT_CRC / 32) | _DICT_SNAPSHOT_COMP )
+#if defined(_DICT_COMPRESS_SHOCO)
+#define _DICT_SNAPSHOT_COMP 0x10
+#elif defined(_DICT_COMPRESS_SMAZ)
+#define _DICT_SNAPSHOT_COMP 0x20
+#else
+#define _DICT_SNAPSHOT_COMP 0x00
+#endif
+
+static size_t dict_write16(Stream& out, uint16_t v) {
+    uint8_t b[2] = { (uint8_t)(v & 0xff), (uint8_t)(v >> 8) };
+    return out.write(b, 2);
 }
 
+int8_t Dictionary::save(Stream& out) const {
+    _DICT_RLOCK;
+    size_t ct = count();
 
-int8_t Dictionary::merge(Dictionary& dict) {
-    size_t ct = dict.count();
-    int8_t rc;
+    if ( out.write((const uint8_t*)"DCT1", 4) != 4 ) return DICTIONARY_ERR;
+    if ( out.write(_DICT_SNAPSHOT_CFG) != 1 ) return DICTIONARY_ERR;
+    if ( dict_write16(out, (uint16_t)(ct & 0xffff)) != 2 ) return DICTIONARY_ERR;
+    if ( dict_write16(out, (uint16_t)(ct >> 16)) != 2 ) return DICTIONARY_ERR;
 
     for (size_t i = 0; i < ct; i++) {
-        rc = insert(dict(i), dict[i]);
-        if (rc) return rc;
+        node* p = (*Q)[i];
+
+        if ( dict_write16(out, p->ksize) != 2 ) return DICTIONARY_ERR;
+        if ( dict_write16(out, p->vsize) != 2 ) return DICTIONARY_ERR;
+        if ( out.write((const uint8_t*)p->keyptr(), p->ksize) != p->ksize ) return DICTIONARY_ERR;
+        if ( p->vsize && out.write((const uint8_t*)p->valptr(), p->vsize) != p->vsize ) return DICTIONARY_ERR;
     }
     return DICTIONARY_OK;
 }
 
-// ==== OPERATORS ====================================
+static int8_t dict_read16(Stream& in, uint16_t& v) {
+    uint8_t b[2];
 
-bool Dictionary::operator () (const String& keystr) {
-    iKeyLen = keystr.length();
-    if (iKeyLen > _DICT_KEYLEN) return false;
+    if ( in.readBytes(b, 2) != 2 ) return DICTIONARY_EOF;
+    v = (uint16_t)b[0] | ((uint16_t)b[1] << 8);
+    return DICTIONARY_OK;
+}
+
+int8_t Dictionary::load(Stream& in) {
+    _DICT_WLOCK;
+    applyAllocPolicy();
+    uint8_t  hdr[5];
+    uint16_t lo, hi;
+    char     kb[_DICT_KEYLEN + 1];
+    char     vb[_DICT_VALLEN + 1];
+
+    if ( in.readBytes(hdr, 5) != 5 ) return DICTIONARY_EOF;
+    if ( memcmp(hdr, "DCT1", 4) != 0 ) return DICTIONARY_FMT;
+    if ( hdr[4] != _DICT_SNAPSHOT_CFG ) return DICTIONARY_FMT;  // incompatible build options
 
+    if ( dict_read16(in, lo) || dict_read16(in, hi) ) return DICTIONARY_EOF;
+    size_t ct = (size_t)lo | ((size_t)hi << 16);
+    int8_t rc = DICTIONARY_OK;
+
+    // the snapshot header says how many records follow - grow the node
+    // array once (best effort: append falls back to incremental growth)
+    if (ct) Q->reserve(count() + ct);
+
+    for (size_t i = 0; i < ct; i++) {
+        uint16_t klen, vlen;
+
+        if ( dict_read16(in, klen) || dict_read16(in, vlen) ) { rc = DICTIONARY_EOF; break; }
+        if ( klen == 0 || klen > _DICT_KEYLEN + 1 || vlen > _DICT_VALLEN + 1 ) { rc = DICTIONARY_FMT; break; }
+        if ( in.readBytes(kb, klen) != klen ) { rc = DICTIONARY_EOF; break; }
+        if ( vlen && in.readBytes(vb, vlen) != vlen ) { rc = DICTIONARY_EOF; break; }
+
+        // records are already in their stored form - append them directly,
+        // bypassing the compression path of the public insert; the tree is
+        // constructed in one balanced pass below
 #ifdef _DICT_COMPRESS
-    int8_t rc;
-    if ( (rc = compressKey(keystr.c_str())) ) return false;
-#else
-    iKeyTemp = (char*) keystr.c_str();
+        // the snapshot only carries stored bytes - decompress once here to
+        // recover the plain lengths for the running size counters
+        char pb[(_DICT_KEYLEN > _DICT_VALLEN ? _DICT_KEYLEN : _DICT_VALLEN) + 1];
+        iKeyPlain = decompressKeyTo(kb, (_DICT_KEY_TYPE)klen, pb);
+        iValPlain = decompressValueTo(vb, (_DICT_VAL_TYPE)vlen, pb);
 #endif
+        rc = appendNode(crc(kb, klen), kb, (_DICT_KEY_TYPE)klen, vb, (_DICT_VAL_TYPE)vlen);
+        if (rc) break;
+    }
 
-    uintNN_t key = crc(iKeyTemp, iKeyLen);
+    // link everything appended so far even on error, so the tree and the
+    // node array stay consistent
+    int8_t rrc = rebuild();
+    return rc ? rc : rrc;
+}
 
-    node* p = search(key, iRoot, iKeyTemp, iKeyLen);
-    if (p) return true;
-    return false;
+
+int8_t Dictionary::merge(const Dictionary& dict) {
+    if (&dict == this) return DICTIONARY_OK;  // self-merge is a no-op
+    _DICT_WLOCK;
+    applyAllocPolicy();
+#ifdef _DICT_THREADSAFE
+    ReadGuard _dict_src(dict);  // hold the source steady while copying
+#endif
+    size_t ct = dict.count();
+    int8_t rc = DICTIONARY_OK;
+
+    // the final entry count is known - grow the node array once (best
+    // effort: append falls back to incremental growth)
+    if (ct) Q->reserve(count() + ct);
+
+    // copy the source nodes in their stored form (no decompress/recompress
+    // round trip) and rebuild the tree once, instead of paying a full
+    // root-to-leaf descent per entry
+    for (size_t i = 0; i < ct; i++) {
+        node* p = (*dict.Q)[i];
+
+#ifdef _DICT_COMPRESS
+        // plain lengths travel with the source node - no decompression
+        iKeyPlain = p->kplain;
+        iValPlain = p->vplain;
+#endif
+        rc = appendNode(p->key(), p->keyptr(), p->ksize, p->valptr(), p->vsize);
+        if (rc) break;
+    }
+
+    int8_t rrc = rebuild();
+    return rc ? rc : rrc;
+}
+
+
+// ==== MOVE SEMANTICS ==============================================
+// a macro rather than a template taking references: the members of a
+// _DICT_PACK_STRUCTURES build may be unaligned and cannot bind to T&
+#define _DICT_SWAP_VAL(a, b) { decltype(a) _t = (a); (a) = (b); (b) = _t; }
+
+// O(1) content exchange: the node array, the search structure and the
+// running counters change hands - no entry is copied, decompressed or
+// reallocated. This is the cheap way to replace a live configuration with
+// a freshly loaded one:
+//     staging.jload(update);
+//     live.swap(staging);    // staging now holds the previous config
+void Dictionary::swap(Dictionary& dict) {
+    if (&dict == this) return;
+#ifdef _DICT_THREADSAFE
+    // lock both, lower address first, so two tasks cross-swapping the
+    // same pair cannot deadlock
+    WriteGuard _dict_a(*(this < &dict ? this : &dict));
+    WriteGuard _dict_b(*(this < &dict ? &dict : this));
+#endif
+    // cached decompressed values point into nodes that change owner
+    cacheClear();
+    dict.cacheClear();
+
+    _DICT_SWAP_VAL(iRoot, dict.iRoot);
+    _DICT_SWAP_VAL(Q, dict.Q);
+    _DICT_SWAP_VAL(initSize, dict.initSize);
+    _DICT_SWAP_VAL(iFP, dict.iFP);
+    _DICT_SWAP_VAL(iSize, dict.iSize);
+#ifdef _DICT_COMPRESS
+    _DICT_SWAP_VAL(iPlainSize, dict.iPlainSize);
+#endif
+#ifdef _DICT_ENGINE_HASH
+    _DICT_SWAP_VAL(iTable, dict.iTable);
+    _DICT_SWAP_VAL(iCap, dict.iCap);
+#endif
 }
 
+// Take over another dictionary's contents wholesale, destroying whatever
+// this dictionary held; the source is left empty but fully usable. Backs
+// the move assignment operator.
+void Dictionary::adopt(Dictionary&& dict) {
+    if (&dict == this) return;
+    destroy();
+    swap(dict);
+}
 
-bool Dictionary::operator == (Dictionary& b) {
-    if (b.size() != size()) return false;
+// Node-stealing merge: every source node is re-registered in this
+// dictionary by a pointer append - keys and values are never copied or
+// recompressed - and the source is left empty. Overlapping keys take the
+// source's value, same as the copying merge().
+int8_t Dictionary::merge(Dictionary&& dict) {
+    if (&dict == this) return DICTIONARY_OK;
+#ifdef _DICT_THREADSAFE
+    WriteGuard _dict_a(*(this < &dict ? this : &dict));
+    WriteGuard _dict_b(*(this < &dict ? &dict : this));
+#endif
+    applyAllocPolicy();
+    size_t ct = dict.count();
+
+    for (size_t i = 0; i < ct; i++) {
+        if (Q->append((*dict.Q)[i]) != NODEARRAY_OK) {
+            // pull the pointers stolen so far back out and restore the
+            // source's slot indexes, leaving both dictionaries intact
+            for (size_t j = 0; j < i; j++) Q->remove((*dict.Q)[j]);
+            for (size_t j = 0; j < ct; j++) (*dict.Q)[j]->qidx = j;
+            return DICTIONARY_MEM;
+        }
+    }
+
+    // the counters travel with the nodes; rebuild() below settles any
+    // overlapping keys (and their counter shares) the usual way
+    iFP ^= dict.iFP;
+    iSize += dict.iSize;
+#ifdef _DICT_COMPRESS
+    iPlainSize += dict.iPlainSize;
+#endif
+
+    dict.cacheClear();
+    dict.Q->clear();
+    dict.iRoot = NULL;
+    dict.iFP = 0;
+    dict.iSize = 0;
+#ifdef _DICT_COMPRESS
+    dict.iPlainSize = 0;
+#endif
+#ifdef _DICT_ENGINE_HASH
+    if (dict.iTable) {
+        _dict_free(dict.iTable);
+        dict.iTable = NULL;
+        dict.iCap = 0;
+    }
+#endif
+
+    return rebuild();
+}
+
+// ==== OPERATORS ====================================
+
+bool Dictionary::operator () (const String& keystr) const {
+    _DICT_RLOCK;
+    return lookupNode(keystr.c_str()) != NULL;
+}
+
+
+bool Dictionary::operator == (const Dictionary& b) const {
+    _DICT_RLOCK;
+#ifdef _DICT_THREADSAFE
+    ReadGuard _dict_other(b);  // nested read locks are safe, even on self
+#endif
     if (b.count() != count()) return false;
+    // content fingerprints disagree - definitely not equal, O(1)
+    if (b.iFP != iFP) return false;
+
+    // fingerprints match: almost certainly equal, but verify against a
+    // hash collision - comparing the stored bytes directly, without
+    // materializing every entry as a String
     size_t ct = count();
     for (size_t i = 0; i < ct; i++) {
-        if (value(i) != b[key(i)]) return false;
+        node* p = (*Q)[i];
+        node* q = b.search(p->key(), b.iRoot, p->keyptr(), p->ksize);
+
+        if (!q) return false;
+        if (q->vsize != p->vsize || memcmp(q->valptr(), p->valptr(), p->vsize)) return false;
     }
     return true;
 }
@@ -732,194 +1654,580 @@ bool Dictionary::operator == (Dictionary& b) {
 
 
 
-// ==== PRIVATE METHODS ====================================================
-// ==== INSERTS ============================================================
-int8_t Dictionary::insert(uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen, const char* valstr, _DICT_VAL_TYPE vallen, node* leaf) {
-    if (key < leaf->key()) {
-        if (leaf->left != NULL)
-            return insert(key, keystr, keylen, valstr, vallen, leaf->left);
-        else {
-            int8_t rc;
-
-            leaf->left = new node;
-            if (!leaf->left) return DICTIONARY_MEM;
-            rc = leaf->left->create(keystr, keylen, valstr, vallen, NULL, NULL);
-            if (rc) {
-                delete leaf->left;
-                return rc;
-            }
-            rc = Q->append(leaf->left);
-            if (rc) {
-                delete leaf->left;
-                return rc;
-            }
+// ==== CONTENT FINGERPRINT ================================================
+// Every entry is hashed (FNV-1a over its stored key and value bytes, key
+// length included as a delimiter) and the per-entry hashes are combined by
+// XOR, so the fingerprint is independent of insertion order and a single
+// insert/update/remove adjusts it in O(1). Equal content implies equal
+// fingerprints; operator== uses a mismatch as an instant "not equal".
+static uint32_t dict_fnv1a32(uint32_t h, const void* data, size_t n) {
+    const uint8_t* p = (const uint8_t*)data;
+
+    while (n--) {
+        h ^= *p++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+static uint32_t dict_entry_fp(const char* k, size_t kl, const char* v, size_t vl) {
+    uint16_t klen = (uint16_t)kl;
+    uint32_t h = dict_fnv1a32(2166136261UL, &klen, sizeof(klen));
+
+    h = dict_fnv1a32(h, k, kl);
+    return dict_fnv1a32(h, v, vl);
+}
+
+static inline uint32_t dict_entry_fp(node* p) {
+    return dict_entry_fp(p->keyptr(), p->ksize, p->valptr(), p->vsize);
+}
+
+
+#ifdef _DICT_ENGINE_HASH
+// ==== HASH TABLE ENGINE ==================================================
+// The same private entry points the tree engine provides (insert, search,
+// deleteNode, rebuild), implemented over a flat power-of-two array of
+// (hash, node*) slots with robin hood probing and backward-shift deletion
+// - no tombstones, so probe chains never degrade over delete churn. The
+// node*/node*& parameters of the shared signatures are unused here; iRoot
+// simply stays NULL.
+
+inline size_t Dictionary::homeSlot(uintNN_t h) const {
+    // Fibonacci hashing: one odd multiply spreads even the first-bytes
+    // keys of the default crc() across the table; with _DICT_HASH_FNV the
+    // input is already well mixed and the multiply does no harm
+    return ((size_t)h * (size_t)0x9E3779B97F4A7C15ULL) & (iCap - 1);
+}
+
+// Returns the slot holding this exact key, or (size_t)-1. The robin hood
+// invariant bounds the probe: once we reach a slot whose resident is
+// closer to its home than we are to ours, the key cannot be further along.
+size_t Dictionary::tableFind(uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen) const {
+    if (!iCap) return (size_t)-1;
+
+    size_t i = homeSlot(key);
+    size_t dist = 0;
+
+    while (iTable[i].n) {
+#ifdef _DICT_STATS
+        // every engine operation (lookup, insert, delete) starts with this
+        // probe, so the counter reads as "slots inspected"
+        iSearchCmps++;
+#endif
+        if (iTable[i].h == key) {
+            node* p = iTable[i].n;
+            if (p->ksize == keylen && memcmp(p->keyptr(), keystr, keylen) == 0) return i;
         }
+        if (((i + iCap - homeSlot(iTable[i].h)) & (iCap - 1)) < dist) break;
+        i = (i + 1) & (iCap - 1);
+        dist++;
     }
-    else if (key > leaf->key()) {
-        if (leaf->right != NULL)
-            return insert(key, keystr, keylen, valstr, vallen, leaf->right);
+    return (size_t)-1;
+}
+
+// Robin hood placement of a key known NOT to be in the table: whenever the
+// incoming entry is further from its home slot than the resident, they
+// swap, keeping all probe chains short and uniform.
+void Dictionary::tablePlace(uintNN_t h, node* p) {
+    size_t i = homeSlot(h);
+    size_t dist = 0;
+
+    while (iTable[i].n) {
+#ifdef _DICT_STATS
+        // placement steps, including re-placement during a rehash - a
+        // rising ratio to searchCmps means the table is clustering
+        iInsertCmps++;
+#endif
+        size_t d = (i + iCap - homeSlot(iTable[i].h)) & (iCap - 1);
+
+        if (d < dist) {
+            uintNN_t th = iTable[i].h;
+            node*    tn = iTable[i].n;
+            iTable[i].h = h;
+            iTable[i].n = p;
+            h = th;
+            p = tn;
+            dist = d;
+        }
+        i = (i + 1) & (iCap - 1);
+        dist++;
+    }
+    iTable[i].h = h;
+    iTable[i].n = p;
+}
+
+// Swap in a fresh table big enough to hold aMin entries at no more than
+// 75% load and re-place whatever the old table held (hashes are stored in
+// the slots, so a rehash never touches the nodes).
+int8_t Dictionary::tableRehash(size_t aMin) {
+    size_t cap = 8;
+    while (cap * 3 < aMin * 4) cap <<= 1;
+
+#ifdef _DICT_STATS
+    iRehashes++;
+#endif
+
+    hslot* t = (hslot*)_dict_malloc(cap * sizeof(hslot));
+    if (!t) return DICTIONARY_MEM;
+    memset(t, 0, cap * sizeof(hslot));
+
+    hslot* old = iTable;
+    size_t oldcap = iCap;
+    iTable = t;
+    iCap = cap;
+
+    if (old) {
+        for (size_t j = 0; j < oldcap; j++) {
+            if (old[j].n) tablePlace(old[j].h, old[j].n);
+        }
+        _dict_free(old);
+    }
+    return DICTIONARY_OK;
+}
+
+node* Dictionary::search(uintNN_t key, node*, const char* keystr, _DICT_KEY_TYPE keylen) const {
+    size_t i = tableFind(key, keystr, keylen);
+
+    return i == (size_t)-1 ? NULL : iTable[i].n;
+}
+
+int8_t Dictionary::insert(uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen, const char* valstr, _DICT_VAL_TYPE vallen, node*&) {
+    int8_t rc;
+    size_t i = tableFind(key, keystr, keylen);
+
+    if (i != (size_t)-1) {
+        // this key already exists - just update the value
+        node* leaf = iTable[i].n;
+
+        cacheInvalidate(leaf);
+        uint32_t oldfp = dict_entry_fp(leaf);
+        _DICT_VAL_TYPE oldvs = leaf->vsize;
+        if (leaf->updateValue(valstr, vallen) != NODEARRAY_OK) return DICTIONARY_MEM;
+        iFP ^= oldfp ^ dict_entry_fp(leaf);
+        iSize = iSize - oldvs + leaf->vsize;
+#ifdef _DICT_COMPRESS
+        iPlainSize = iPlainSize - leaf->vplain + iValPlain;
+        leaf->vplain = iValPlain;
+#endif
+        return DICTIONARY_OK;
+    }
+
+    // grow at 75% load (this also allocates the initial table)
+    if ((count() + 1) * 4 > iCap * 3) {
+        rc = tableRehash(count() + 1);
+        if (rc) return rc;
+    }
+
+    node* p = new node;
+    if (!p) return DICTIONARY_MEM;
+    rc = p->create(keystr, keylen, valstr, vallen, NULL, NULL);
+#ifdef _DICT_HASH_FNV
+    if (!rc) p->hkey = key;
+#endif
+    if (!rc) rc = Q->append(p);
+    if (rc) {
+        delete p;
+        return rc;
+    }
+    tablePlace(key, p);
+    iFP ^= dict_entry_fp(p);
+    iSize += p->ksize + p->vsize;
+#ifdef _DICT_COMPRESS
+    p->kplain = iKeyPlain;
+    p->vplain = iValPlain;
+    iPlainSize += iKeyPlain + iValPlain;
+#endif
+
+    return DICTIONARY_OK;
+}
+
+node* Dictionary::deleteNode(node*, uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen) {
+    size_t i = tableFind(key, keystr, keylen);
+
+    if (i != (size_t)-1) {
+        node* n = iTable[i].n;
+
+        cacheInvalidate(n);
+        iFP ^= dict_entry_fp(n);
+        iSize -= n->ksize + n->vsize;
+#ifdef _DICT_COMPRESS
+        iPlainSize -= n->kplain + n->vplain;
+#endif
+        Q->remove(n);
+        delete n;
+
+        // backward-shift deletion: pull every displaced successor one slot
+        // back until a hole or an entry sitting in its home slot
+        size_t j = (i + 1) & (iCap - 1);
+        while (iTable[j].n && ((j + iCap - homeSlot(iTable[j].h)) & (iCap - 1)) != 0) {
+            iTable[i] = iTable[j];
+            i = j;
+            j = (j + 1) & (iCap - 1);
+        }
+        iTable[i].n = NULL;
+    }
+    return NULL;  // the caller assigns this to iRoot, which stays NULL
+}
+
+// The bulk paths (build, merge, load) append everything to the node array
+// first and then call this: re-place every node in a right-sized fresh
+// table, evicting older duplicates as they collide (last-appended wins,
+// matching insert() semantics).
+int8_t Dictionary::rebuild() {
+    size_t ct = count();
+
+    iRoot = NULL;
+    if (iTable) {
+        _dict_free(iTable);
+        iTable = NULL;
+        iCap = 0;
+    }
+    if (!ct) return DICTIONARY_OK;
+
+    int8_t rc = tableRehash(ct);
+    if (rc) return rc;
+
+    // snapshot the array first: dropping a duplicate shuffles Q, but the
+    // snapshot keeps the append order that decides which duplicate wins
+    node** arr = (node**)_dict_malloc(ct * sizeof(node*));
+    if (!arr) return DICTIONARY_MEM;
+    for (size_t i = 0; i < ct; i++) arr[i] = (*Q)[i];
+
+    for (size_t i = 0; i < ct; i++) {
+        node* p = arr[i];
+        size_t s = tableFind(p->key(), p->keyptr(), p->ksize);
+
+        if (s != (size_t)-1) {  // drop the older duplicate of this key
+            node* q = iTable[s].n;
+
+            cacheInvalidate(q);
+            iFP ^= dict_entry_fp(q);
+            iSize -= q->ksize + q->vsize;
+#ifdef _DICT_COMPRESS
+            iPlainSize -= q->kplain + q->vplain;
+#endif
+            Q->remove(q);
+            delete q;
+            iTable[s].n = p;  // same key, same hash - the slot is reusable in place
+        }
         else {
-            int8_t rc;
-
-            leaf->right = new node;
-            if (!leaf->right) return DICTIONARY_MEM;
-            rc = leaf->right->create(keystr, keylen, valstr, vallen, NULL, NULL);
-            if (rc) {
-                delete leaf->right;
-                return rc;
-            }
-            rc = Q->append(leaf->right);
-            if (rc) {
-                delete leaf->right;
-                return rc;
-            }
+            tablePlace(p->key(), p);
         }
     }
-    else if (key == leaf->key()) {
-        int cmpres = keylen != leaf->ksize ? keylen - leaf->ksize : memcmp(leaf->keybuf, keystr, keylen);
+
+    _dict_free(arr);
+    return DICTIONARY_OK;
+}
+
+#endif // _DICT_ENGINE_HASH
+
+
+// ==== PRIVATE METHODS ====================================================
+// ==== INSERTS ============================================================
+#ifndef _DICT_ENGINE_HASH
+int8_t Dictionary::insert(uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen, const char* valstr, _DICT_VAL_TYPE vallen, node*& root) {
+    int8_t rc;
+    node** cur = &root;
+
+#ifdef _DICT_BALANCED
+    node**  path[_DICT_MAX_DEPTH];  // parent links traversed, for bottom-up rebalancing
+    size_t  depth = 0;
+#endif
+
+    // walk down the tree iteratively - no recursion, no stack growth:
+    // compare first by the uintNN_t key, then by length, then byte-by-byte
+    while (*cur != NULL) {
+        node* leaf = *cur;
+        int cmpres;
+
+#ifdef _DICT_STATS
+        iInsertCmps++;
+#endif
+        if (key < leaf->key()) cmpres = -1;
+        else if (key > leaf->key()) cmpres = 1;
+        else cmpres = keylen != leaf->ksize ? keylen - leaf->ksize : memcmp(leaf->keyptr(), keystr, keylen);
+
         if (cmpres == 0) {
+            // this key already exists - just update the value
+            cacheInvalidate(leaf);
+            uint32_t oldfp = dict_entry_fp(leaf);
+            _DICT_VAL_TYPE oldvs = leaf->vsize;
             if (leaf->updateValue(valstr, vallen) != NODEARRAY_OK) return DICTIONARY_MEM;
+            iFP ^= oldfp ^ dict_entry_fp(leaf);
+            iSize = iSize - oldvs + leaf->vsize;
+#ifdef _DICT_COMPRESS
+            iPlainSize = iPlainSize - leaf->vplain + iValPlain;
+            leaf->vplain = iValPlain;
+#endif
+            return DICTIONARY_OK;
         }
-        else {
 
-            if (cmpres < 0) {
-                if (leaf->left != NULL)
-                    return insert(key, keystr, keylen, valstr, vallen, leaf->left);
-                else {
-                    int8_t rc;
-
-                    leaf->left = new node;
-                    if (!leaf->left) return DICTIONARY_MEM;
-                    rc = leaf->left->create(keystr, keylen, valstr, vallen, NULL, NULL);
-                    if (rc) {
-                        delete leaf->left;
-                        return rc;
-                    }
-                    rc = Q->append(leaf->left);
-                    if (rc) {
-                        delete leaf->left;
-                        return rc;
-                    }
-                }
-            }
-            else if (cmpres > 0) {
-                if (leaf->right != NULL)
-                    return insert(key, keystr, keylen, valstr, vallen, leaf->right);
-                else {
-                    int8_t rc;
-
-                    leaf->right = new node;
-                    if (!leaf->right) return DICTIONARY_MEM;
-                    rc = leaf->right->create(keystr, keylen, valstr, vallen, NULL, NULL);
-                    if (rc) {
-                        delete leaf->right;
-                        return rc;
-                    }
-                    rc = Q->append(leaf->right);
-                    if (rc) {
-                        delete leaf->right;
-                        return rc;
-                    }
-                }
-            }
+#ifdef _DICT_BALANCED
+        // a balanced tree is never deeper than _DICT_MAX_DEPTH, so this
+        // always fits; should it ever not, the tree just stays valid but
+        // skips rebalancing at the levels that did not fit
+        if (depth < _DICT_MAX_DEPTH) path[depth++] = cur;
+#endif
+
+        cur = cmpres < 0 ? &leaf->left : &leaf->right;
+    }
+
+    *cur = new node;
+    if (!*cur) return DICTIONARY_MEM;
+    rc = (*cur)->create(keystr, keylen, valstr, vallen, NULL, NULL);
+#ifdef _DICT_HASH_FNV
+    if (!rc) (*cur)->hkey = key;
+#endif
+    if (rc) {
+        delete *cur;
+        *cur = NULL;
+        return rc;
+    }
+    rc = Q->append(*cur);
+    if (rc) {
+        delete *cur;
+        *cur = NULL;
+        return rc;
+    }
+    iFP ^= dict_entry_fp(*cur);
+    iSize += (*cur)->ksize + (*cur)->vsize;
+#ifdef _DICT_COMPRESS
+    (*cur)->kplain = iKeyPlain;
+    (*cur)->vplain = iValPlain;
+    iPlainSize += iKeyPlain + iValPlain;
+#endif
+
+#ifdef _DICT_BALANCED
+    while (depth) {
+        node** link = path[--depth];
+        *link = rebalance(*link);
+    }
+#endif
+
+    return DICTIONARY_OK;
+}
+#endif // !_DICT_ENGINE_HASH
+
+// Create a node and register it in the node array WITHOUT linking it into
+// the tree or the hash table - the bulk paths (build, merge, load) append
+// everything first and then construct the index in one pass with rebuild().
+int8_t Dictionary::appendNode(uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen, const char* valstr, _DICT_VAL_TYPE vallen) {
+    int8_t rc;
+    node* p = new node;
+
+    if (!p) return DICTIONARY_MEM;
+    rc = p->create(keystr, keylen, valstr, vallen, NULL, NULL);
+#ifdef _DICT_HASH_FNV
+    if (!rc) p->hkey = key;
+#endif
+    if (!rc) rc = Q->append(p);
+    if (rc) {
+        delete p;
+        return rc;
+    }
+    iFP ^= dict_entry_fp(p);
+    iSize += p->ksize + p->vsize;
+#ifdef _DICT_COMPRESS
+    // every caller is responsible for having set iKeyPlain/iValPlain to
+    // the plain-text lengths of the pair it is appending
+    p->kplain = iKeyPlain;
+    p->vplain = iValPlain;
+    iPlainSize += iKeyPlain + iValPlain;
+#endif
+    return DICTIONARY_OK;
+}
+
+
+#ifndef _DICT_ENGINE_HASH
+// ==== BULK TREE CONSTRUCTION =============================================
+// Same ordering the tree uses: uintNN_t key first, then length, then
+// byte-by-byte; ties (duplicate keys) are broken by append order so that
+// the last-appended node sorts last and wins, matching insert() semantics.
+// NOTE the negated memcmp: when the integer key and the length both tie,
+// insert()/search() send the lexically GREATER key into the LEFT subtree
+// (their cmpres is leaf-relative at that step), so the in-order position
+// within such a tie runs lexically descending and the sort has to match,
+// or keys sharing their first sizeof(uintNN_t) bytes at equal length
+// become unfindable in a rebuild()-built tree.
+static int dict_node_cmp(const void* a, const void* b) {
+    node* x = *(node* const*)a;
+    node* y = *(node* const*)b;
+
+    if (x->key() != y->key()) return x->key() < y->key() ? -1 : 1;
+    if (x->ksize != y->ksize) return x->ksize < y->ksize ? -1 : 1;
+    int cmpres = memcmp(x->keyptr(), y->keyptr(), x->ksize);
+    if (cmpres) return -cmpres;
+    return x->qidx < y->qidx ? -1 : (x->qidx > y->qidx ? 1 : 0);
+}
+
+static bool dict_node_keyeq(node* x, node* y) {
+    return x->key() == y->key() && x->ksize == y->ksize && memcmp(x->keyptr(), y->keyptr(), x->ksize) == 0;
+}
+
+// Links the sorted slice [lo, hi) into a perfectly balanced subtree.
+// Recursion depth is log2(n) - a dictionary large enough to overflow the
+// stack here cannot exist in memory in the first place.
+node* Dictionary::buildSubtree(node* const* arr, size_t lo, size_t hi) {
+    if (lo >= hi) return NULL;
+
+    size_t mid = lo + (hi - lo) / 2;
+    node* n = arr[mid];
+
+    n->left = buildSubtree(arr, lo, mid);
+    n->right = buildSubtree(arr, mid + 1, hi);
+#ifdef _DICT_BALANCED
+    updateHeight(n);
+#endif
+    return n;
+}
+
+// Discard the current tree links and rebuild a perfectly balanced tree
+// over every node in the array in a single pass: sort once, collapse
+// duplicate keys (last-appended wins), link bottom-up.
+int8_t Dictionary::rebuild() {
+    size_t ct = count();
+
+    iRoot = NULL;
+    if (!ct) return DICTIONARY_OK;
+
+    node** arr = (node**)_dict_malloc(ct * sizeof(node*));
+    if (!arr) return DICTIONARY_MEM;
+    for (size_t i = 0; i < ct; i++) arr[i] = (*Q)[i];
+    qsort(arr, ct, sizeof(node*), dict_node_cmp);
+
+    size_t n = 0;
+    for (size_t i = 0; i < ct; ) {
+        size_t j = i + 1;
+        while (j < ct && dict_node_keyeq(arr[i], arr[j])) j++;
+        for (size_t k = i; k < j - 1; k++) {  // drop all but the newest duplicate
+            cacheInvalidate(arr[k]);
+            iFP ^= dict_entry_fp(arr[k]);
+            iSize -= arr[k]->ksize + arr[k]->vsize;
+#ifdef _DICT_COMPRESS
+            iPlainSize -= arr[k]->kplain + arr[k]->vplain;
+#endif
+            Q->remove(arr[k]);
+            delete arr[k];
         }
+        arr[n++] = arr[j - 1];
+        i = j;
     }
+
+    iRoot = buildSubtree(arr, 0, n);
+    _dict_free(arr);
     return DICTIONARY_OK;
 }
 
 
 // ==== SEARCH ===========================================================================
-node* Dictionary::search(uintNN_t key, node* leaf, const char* keystr, _DICT_KEY_TYPE keylen) {
-    if (leaf != NULL) {
+node* Dictionary::search(uintNN_t key, node* leaf, const char* keystr, _DICT_KEY_TYPE keylen) const {
+    while (leaf != NULL) {
+#ifdef _DICT_STATS
+        iSearchCmps++;
+#endif
         if ( key == leaf->key() ) {
-            int cmpres = keylen != leaf->ksize ? keylen - leaf->ksize : memcmp(leaf->keybuf, keystr, keylen);
+            int cmpres = keylen != leaf->ksize ? keylen - leaf->ksize : memcmp(leaf->keyptr(), keystr, keylen);
 
-            if (cmpres == 0) {
-                return leaf;
-            }
-            else {
-                if ( cmpres < 0 )
-                    return search(key, leaf->left, keystr, keylen);
-                else
-                    return search(key, leaf->right, keystr, keylen);
-            }
+            if (cmpres == 0) return leaf;
+            leaf = cmpres < 0 ? leaf->left : leaf->right;
         }
         else {
-            if ( key < leaf->key() )
-                return search(key, leaf->left, keystr, keylen);
-            else
-                return search(key, leaf->right, keystr, keylen);
+            leaf = key < leaf->key() ? leaf->left : leaf->right;
         }
     }
-    else return NULL;
+    return NULL;
 }
 
 
 // ==== DELETES ==========================================================================
-void Dictionary::destroy_tree(node* leaf) {
-  if (leaf != NULL) {
-    destroy_tree(leaf->left);
-    destroy_tree(leaf->right);
-    delete leaf; // node destructor takes care of the key and value strings
-    leaf = NULL;
-  }
-}
+node* Dictionary::deleteNode(node* root, uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen) {
+  node** cur = &root;
 
+#ifdef _DICT_BALANCED
+  node**  path[_DICT_MAX_DEPTH];  // links traversed, for bottom-up rebalancing
+  size_t  depth = 0;
+#define _DICT_PUSH(link) { if (depth < _DICT_MAX_DEPTH) path[depth++] = (link); }
+#else
+#define _DICT_PUSH(link)
+#endif
 
-node* Dictionary::deleteNode(node* root, uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen) {
-  if (root == NULL) return root;
+  // find the link pointing to the node to be deleted
+  while (*cur != NULL) {
+    node* n = *cur;
+    int cmpres;
 
-  if (key < root->key() ) {
-    root->left = deleteNode(root->left, key, keystr, keylen);
-  }
-  // If the key to be deleted is greater than the root's key,
-  // then it lies in right subtree
-  else if (key > root->key() ) {
-    root->right = deleteNode(root->right, key, keystr, keylen);
-  }
-  // if key is same as root's key, then This is the node
-  // to be deleted
-  else {
-    int cmpres = (keylen != root->ksize) ? keylen - root->ksize : memcmp(root->keybuf, keystr, keylen);
-    if (cmpres == 0 ) {
-      // node with only one child or no child
-      if (root->left == NULL) {
-        node* temp = root->right;
-        Q->remove(root);
-        delete root;
-        root = NULL;
-        return temp;
-      }
-      else if (root->right == NULL) {
-        node* temp = root->left;
-        Q->remove(root);
-        delete root;
-        root = NULL;
-        return temp;
-      }
+    if (key < n->key()) cmpres = -1;
+    else if (key > n->key()) cmpres = 1;
+    else cmpres = (keylen != n->ksize) ? keylen - n->ksize : memcmp(n->keyptr(), keystr, keylen);
+
+    if (cmpres == 0) break;
 
-      // node with two children: Get the in-order successor (smallest
-      // in the right subtree)
-      node* temp = minValueNode(root->right);
+    _DICT_PUSH(cur);
+    cur = cmpres < 0 ? &n->left : &n->right;
+  }
 
-      // Copy the in-order successor's content to this node
-      root->updateKey(temp->keybuf, temp->ksize);
-      root->updateValue(temp->valbuf, temp->vsize);
+  if (*cur != NULL) {
+    node* n = *cur;
+
+    if (n->left != NULL && n->right != NULL) {
+      // node with two children: find the in-order successor (leftmost
+      // node of the right subtree), tracking the links down to it
+      _DICT_PUSH(cur);
+      node** m = &n->right;
+      while ((*m)->left != NULL) {
+        _DICT_PUSH(m);
+        m = &(*m)->left;
+      }
+      node* temp = *m;
+
+      // Copy the in-order successor's content to this node. Counter-wise
+      // only this node's old entry disappears - the successor's entry
+      // survives the move unchanged.
+      cacheInvalidate(n);
+      iFP ^= dict_entry_fp(n);
+      iSize -= n->ksize + n->vsize;
+#ifdef _DICT_COMPRESS
+      iPlainSize -= n->kplain + n->vplain;
+#endif
+      n->updateKey(temp->keyptr(), temp->ksize);
+      n->updateValue(temp->valptr(), temp->vsize);
+#ifdef _DICT_COMPRESS
+      n->kplain = temp->kplain;
+      n->vplain = temp->vplain;
+#endif
+#ifdef _DICT_HASH_FNV
+      n->hkey = temp->key();
+#endif
 
-      // Delete the in-order successor
-      root->right = deleteNode(root->right, temp->key(), temp->keybuf, temp->ksize);
+      // Unlink and delete the in-order successor (it has no left child)
+      *m = temp->right;
+      cacheInvalidate(temp);
+      Q->remove(temp);
+      delete temp;
     }
     else {
-        if ( cmpres < 0 ) {
-            root->left = deleteNode(root->left, key, keystr, keylen);
-        }
-        // If the key to be deleted is greater than the root's key,
-        // then it lies in right subtree
-        else if ( cmpres > 0 ) {
-            root->right = deleteNode(root->right, key, keystr, keylen);
-        }
+      // node with only one child or no child
+      node* temp = n->left != NULL ? n->left : n->right;
+      cacheInvalidate(n);
+      iFP ^= dict_entry_fp(n);
+      iSize -= n->ksize + n->vsize;
+#ifdef _DICT_COMPRESS
+      iPlainSize -= n->kplain + n->vplain;
+#endif
+      Q->remove(n);
+      delete n;
+      *cur = temp;
     }
   }
+
+#ifdef _DICT_BALANCED
+  while (depth) {
+    node** link = path[--depth];
+    *link = rebalance(*link);
+  }
+#endif
+#undef _DICT_PUSH
+
   return root;
 }
 
@@ -932,48 +2240,136 @@ node* Dictionary::minValueNode(node* n) {
 
   return current;
 }
+#endif // !_DICT_ENGINE_HASH
+
+
+#ifdef _DICT_BALANCED
+// ==== AVL BALANCING ====================================================================
+void Dictionary::updateHeight(node* n) {
+  int8_t hl = height(n->left);
+  int8_t hr = height(n->right);
+
+  n->hgt = 1 + ( hl > hr ? hl : hr );
+}
+
+
+node* Dictionary::rotateLeft(node* n) {
+  node* r = n->right;
+
+  n->right = r->left;
+  r->left = n;
+  updateHeight(n);
+  updateHeight(r);
+  return r;
+}
+
+
+node* Dictionary::rotateRight(node* n) {
+  node* l = n->left;
+
+  n->left = l->right;
+  l->right = n;
+  updateHeight(n);
+  updateHeight(l);
+  return l;
+}
+
+
+// Restore the AVL invariant (subtree heights differ by at most 1) for the
+// subtree rooted at n and return its (possibly new) root
+node* Dictionary::rebalance(node* n) {
+  if (n == NULL) return n;
+
+  updateHeight(n);
+  int8_t bf = height(n->left) - height(n->right);
+
+  if (bf > 1) {   // left-heavy
+    if (height(n->left->left) < height(n->left->right))
+      n->left = rotateLeft(n->left);
+    return rotateRight(n);
+  }
+  if (bf < -1) {  // right-heavy
+    if (height(n->right->right) < height(n->right->left))
+      n->right = rotateRight(n->right);
+    return rotateLeft(n);
+  }
+  return n;
+}
+#endif // _DICT_BALANCED
 
 
 // ==== KEY/CRC METHODS ===============================================
 
-uintNN_t Dictionary::crc(const void* data, size_t n_bytes) {
+uintNN_t Dictionary::crc(const void* data, size_t n_bytes) const {
+#if defined(_DICT_HASH_FNV)
+    // FNV-1a over the whole key: keys sharing a common prefix spread
+    // across the tree instead of colliding on their first bytes
+#if _DICT_CRC == 64
+    uint64_t        h = 14695981039346656037ULL;
+    const uint64_t  p = 1099511628211ULL;
+#else
+    uint32_t        h = 2166136261UL;
+    const uint32_t  p = 16777619UL;
+#endif
+    const uint8_t*  s = (const uint8_t*) data;
+
+    for (size_t i = 0; i < n_bytes; i++) {
+        h ^= s[i];
+        h *= p;
+    }
+
+#if _DICT_CRC == 16
+    return (uintNN_t) ((h >> 16) ^ (h & 0xffffUL));  // xor-fold to 16 bits
+#else
+    return (uintNN_t) h;
+#endif
+
+#else  // first-bytes "key" (default, preserves key ordering in the tree)
     uintNN_t    a = 0;
 
     memcpy((void*)&a, data, n_bytes < sizeof(uintNN_t) ? n_bytes : sizeof(uintNN_t));
     return a;
+#endif // _DICT_HASH_FNV
 }
 
 
 #ifdef _DICT_COMPRESS
 
 // ==== COMPRESS METHODS =============================================
-int8_t Dictionary::compressKey(const char* aStr) {
-    memset(iKeyTemp, 0, sizeof(uintNN_t));
+// All take the already-known string length: every caller has just
+// measured it with strnlen, so passing it down saves the compressors a
+// redundant scan over the input.
+int8_t Dictionary::compressKeyTo(const char* aStr, size_t aLen, char* aOut, _DICT_KEY_TYPE& aOutLen) const {
+    memset(aOut, 0, sizeof(uintNN_t));
 
 #if defined (_DICT_COMPRESS_SHOCO)
-    iKeyLen = shoco_compress(aStr, 0, iKeyTemp, _DICT_KEYLEN + 1);
+    aOutLen = shoco_compress(aStr, aLen, aOut, _DICT_KEYLEN + 1);
 
 #elif defined (_DICT_COMPRESS_SMAZ)
-    iKeyLen = smaz_compress((char*) aStr, strlen(aStr), iKeyTemp, _DICT_KEYLEN + 1);
-
-// #else
-//     iKeyLen = strlen(aStr);
-//     memcpy(iKeyTemp, aStr, iKeyLen);
+    aOutLen = smaz_compress((char*) aStr, aLen, aOut, _DICT_KEYLEN + 1);
 
 #endif
 
-    if (iKeyLen > _DICT_KEYLEN + 1) return DICTIONARY_OOB;
+    if (aOutLen > _DICT_KEYLEN + 1) return DICTIONARY_OOB;
 
     return DICTIONARY_OK;
 }
 
-int8_t Dictionary::compressValue(const char* aStr) {
+// writer-path version filling the shared scratch; remembers the plain
+// length so the insert paths can maintain the running size counters
+int8_t Dictionary::compressKey(const char* aStr, size_t aLen) {
+    iKeyPlain = (_DICT_KEY_TYPE)aLen;
+    return compressKeyTo(aStr, aLen, iKeyTemp, iKeyLen);
+}
 
-#if defined (_DICT_COMPRESS_SHOCO) 
-    iValLen = shoco_compress(aStr, 0, iValTemp, _DICT_VALLEN + 1);
+int8_t Dictionary::compressValue(const char* aStr, size_t aLen) {
+    iValPlain = (_DICT_VAL_TYPE)aLen;
+
+#if defined (_DICT_COMPRESS_SHOCO)
+    iValLen = shoco_compress(aStr, aLen, iValTemp, _DICT_VALLEN + 1);
 
 #elif defined (_DICT_COMPRESS_SMAZ)
-    iValLen = smaz_compress((char*) aStr, strlen(aStr), iValTemp, _DICT_VALLEN + 1);
+    iValLen = smaz_compress((char*) aStr, aLen, iValTemp, _DICT_VALLEN + 1);
 
 #endif
 
@@ -982,50 +2378,123 @@ int8_t Dictionary::compressValue(const char* aStr) {
     return DICTIONARY_OK;
 }
 
-void Dictionary::decompressKey(const char* aBuf, _DICT_KEY_TYPE aLen) {
+_DICT_KEY_TYPE Dictionary::decompressKeyTo(const char* aBuf, _DICT_KEY_TYPE aLen, char* aOut) const {
+    _DICT_KEY_TYPE l = 0;
 
 #if defined (_DICT_COMPRESS_SHOCO)
-    iKeyLen = shoco_decompress(aBuf, aLen, iKeyTemp, _DICT_KEYLEN + 1);
-    iKeyTemp[iKeyLen] = 0;
+    l = shoco_decompress(aBuf, aLen, aOut, _DICT_KEYLEN + 1);
 
 #elif defined (_DICT_COMPRESS_SMAZ)
-    iKeyLen = smaz_decompress((char*) aBuf, (int) aLen, iKeyTemp, (int) (_DICT_KEYLEN + 1));
-    iKeyTemp[iKeyLen] = 0;
+    l = smaz_decompress((char*) aBuf, (int) aLen, aOut, (int) (_DICT_KEYLEN + 1));
 
 #endif
+    aOut[l] = 0;
+    return l;
 }
 
-void Dictionary::decompressValue(const char* aBuf, _DICT_VAL_TYPE aLen) {
-    
+_DICT_VAL_TYPE Dictionary::decompressValueTo(const char* aBuf, _DICT_VAL_TYPE aLen, char* aOut) const {
+    _DICT_VAL_TYPE l = 0;
+
 #if defined (_DICT_COMPRESS_SHOCO)
-    iValLen = shoco_decompress(aBuf, aLen, iValTemp, _DICT_VALLEN + 1);
-    iValTemp[iValLen] = 0;
+    l = shoco_decompress(aBuf, aLen, aOut, _DICT_VALLEN + 1);
 
 #elif defined (_DICT_COMPRESS_SMAZ)
-    iValLen = smaz_decompress((char*) aBuf, (int) aLen, iValTemp, (int) (_DICT_VALLEN + 1) );
-    iValTemp[iValLen] = 0;
+    l = smaz_decompress((char*) aBuf, (int) aLen, aOut, (int) (_DICT_VALLEN + 1) );
 
 #endif
+    aOut[l] = 0;
+    return l;
 }
 
+#ifdef _DICT_CACHE
+// Returns a pointer to the decompressed value of a node and its length.
+// The most recently used values are kept in plain text, so hot keys skip
+// the decompression entirely. The LRU bookkeeping mutates the (mutable)
+// cache even on const lookups - with _DICT_CACHE enabled reads are NOT
+// reentrant; see README.
+char* Dictionary::cachedValue(node* p, _DICT_VAL_TYPE& aLen) const {
+    int i;
+
+    applyAllocPolicy();   // the pooled buffers are allocated on first use
+
+    for (i = 0; i < _DICT_CACHE_SIZE; i++) {
+        if (iCache[i].nd == p) break;
+    }
+    if (i == _DICT_CACHE_SIZE) {   // miss - evict the least recently used slot
+        i--;
+        if (!iCache[i].val) {
+            iCache[i].val = (char*)_dict_malloc(_DICT_VALLEN + 1);
+            if (!iCache[i].val) {  // no memory for the pool - just bypass the cache
+                aLen = decompressValueTo(p->valptr(), p->vsize, iValTemp);
+                return iValTemp;
+            }
+        }
+        iCache[i].len = decompressValueTo(p->valptr(), p->vsize, iCache[i].val);
+        iCache[i].nd = p;
+    }
+    aLen = iCache[i].len;
+
+    // move the entry to the front (most recently used first)
+    while (i > 0) {
+        node*          tn = iCache[i].nd;
+        char*          tv = iCache[i].val;
+        _DICT_VAL_TYPE tl = iCache[i].len;
+
+        iCache[i] = iCache[i - 1];
+        iCache[i - 1].nd = tn;
+        iCache[i - 1].val = tv;
+        iCache[i - 1].len = tl;
+        i--;
+    }
+    return iCache[0].val;
+}
+
+// Drop the cache entry of a node whose value is about to change or whose
+// memory is about to be freed. A stale entry on a recycled node pointer
+// would serve the wrong value, so every delete path must come through here.
+void Dictionary::cacheInvalidate(node* p) {
+    for (int i = 0; i < _DICT_CACHE_SIZE; i++) {
+        if (iCache[i].nd == p) {
+            iCache[i].nd = NULL;
+            return;
+        }
+    }
+}
+
+void Dictionary::cacheClear() {
+    for (int i = 0; i < _DICT_CACHE_SIZE; i++) iCache[i].nd = NULL;
+}
+#endif // _DICT_CACHE
+
 #endif // _DICT_COMPRESS
 
 
 // ==== DEBUG METHODS ===================================================
 #ifdef _LIBDEBUG_
 void Dictionary::printDictionary(node* root) {
+#ifdef _DICT_ENGINE_HASH
+  // no tree to traverse - dump the node array instead
+  (void) root;
+  size_t ct = count();
+  for (size_t i = 0; i < ct; i++) printNode((*Q)[i]);
+#else
   if (root != NULL)
   {
     printDictionary(root->left);
     printNode(root);
     printDictionary(root->right);
   }
+#endif
 }
 
 void Dictionary::printNode(node* root) {
   if (root != NULL) {
+#ifdef _DICT_ENGINE_HASH
+    Serial.printf("%u: (%u:%u:%u)\n", (uint32_t)root, root->key(), (uint32_t)root->keybuf, (uint32_t)root->valbuf);
+#else
 //    Serial.printf("%u: (%u:%s,%s %u:%u) [l:%u, r:%u]\n", (uint32_t)root, root->key(), root->keybuf, root->valbuf, (uint32_t)root->keybuf, (uint32_t)root->valbuf, (uint32_t)root->left, (uint32_t)root->right);
     Serial.printf("%u: (%u:%u:%u) [l:%u, r:%u]\n", (uint32_t)root, root->key(), (uint32_t)root->keybuf, (uint32_t)root->valbuf, (uint32_t)root->left, (uint32_t)root->right);
+#endif
   }
   else {
     Serial.println("NULL:");
@@ -95,14 +95,79 @@
    
   v3.3.0:
     2021-05-27 - update: json import does not require quotation marks (still creates strings)
-   
+
+  v3.6.0:
+    2026-08-26 - feature: self-balancing (AVL) tree option (#define _DICT_BALANCED)
+                 feature: FNV-1a key hashing option (#define _DICT_HASH_FNV)
+                 update: iterative search/insert/delete/destroy - safe for
+                 deep (degenerate) trees on small task stacks
+                 update: O(1) node removal from the underlying array
+                 (positional order of key(i)/value(i) is no longer
+                 preserved across removals)
+                 feature: pooled arena allocator (#define _DICT_ARENA)
+                 feature: inline storage for short keys and values
+                 (#define _DICT_SSO)
+                 feature: get() - zero-allocation lookup returning a
+                 pointer to the internal value string
+                 feature: save()/load() - binary snapshot serialization
+                 update: jload() parses into fixed buffers - no transient
+                 String objects on the load path
+                 feature: jsonTo() - streaming JSON serialization into a
+                 Stream with O(1) extra memory
+                 feature: build() - bulk construction of a perfectly
+                 balanced tree; merge() and load() use the same fast path
+                 feature: host-native builds (src/Host shim, extras/host
+                 CMake project) for profiling with desktop tooling
+                 update: known string lengths are passed into shoco/smaz
+                 - no redundant strlen passes on compressed inserts
+                 feature: LRU cache of decompressed values for hot keys
+                 (#define _DICT_CACHE, requires compression)
+                 update: const, reentrant read path - search/key/value/
+                 json/jsonTo/save use stack buffers, no shared scratch
+                 feature: reader-writer concurrency mode for dual-core /
+                 RTOS targets (#define _DICT_THREADSAFE)
+                 feature: FlashDictionary - read-only tables generated
+                 offline (extras/host/dictgen) and searched in PROGMEM
+                 feature: fingerprint() - incrementally maintained content
+                 hash; operator== fails fast on mismatch, no String churn
+                 feature: JsonLoader - resumable chunked jload for
+                 non-blocking loads over slow Streams
+                 feature: forEach() - full scans over const char* entries
+                 with one decompression per entry and no String churn
+                 update: size()/jsize()/esize() are O(1) - byte totals are
+                 maintained incrementally on insert/update/remove
+                 feature: open-addressing robin hood hash table engine
+                 (#define _DICT_ENGINE_HASH) - O(1) lookups over a flat
+                 slot array instead of O(log n) pointer chases
+                 feature: move semantics - swap()/adopt()/move assignment
+                 exchange contents in O(1), merge() of an rvalue steals
+                 the nodes instead of copying entries
+                 feature: forEachPrefix()/forEachRange() - restricted
+                 scans with integer-key pruning where the build allows
+                 feature: ChunkedWriteBufferStream - growable chunked
+                 write target with a zero-copy drain API
+                 feature: instrumentation counters and a stats() snapshot
+                 for field telemetry (#define _DICT_STATS)
+                 update: smaz compression runs over a precomputed trie
+                 (extras/host/smazgen) - same wire format, one linear
+                 pass instead of per-position substring hashing
+                 feature: per-dictionary allocation policy (DICT_ALLOC_*
+                 constructor argument) with a cached psramFound() probe
+                 feature: reserve() - preallocate node/string storage
+                 ahead of bulk loads; node array growth is now geometric
+                 (doubling) instead of linear
+
  */
 
 
 #ifndef _DICTIONARY_H_
 #define _DICTIONARY_H_
 
+#ifdef ARDUINO
 #include <Arduino.h>
+#else
+#include "Host/HostArduino.h"  // host-native build for profiling/fuzzing
+#endif
 
 #ifndef _DICT_KEYLEN
 #define _DICT_KEYLEN 64
@@ -163,6 +228,9 @@
 #define DICTIONARY_FMT      (-25)
 #define DICTIONARY_EOF      (-99)
 
+// not an error: JsonLoader consumed everything available and needs more
+#define DICTIONARY_AGAIN      1
+
 
 // There is no CRC calculation anymore, but the naming stuck
 #ifndef _DICT_CRC
@@ -204,11 +272,170 @@ extern "C" {
 #define _DICT_EXTRA 1
 #endif
 
+#if defined(_DICT_COMPRESS) && defined(_DICT_CACHE)
+// LRU cache of decompressed values: repeated lookups of the same hot keys
+// return the cached plain-text value instead of running shoco/smaz
+// decompression on every hit. Entries are invalidated whenever the value
+// or the node they belong to changes. Only meaningful with compression.
+#ifndef _DICT_CACHE_SIZE
+#define _DICT_CACHE_SIZE 8
+#endif
+#endif
+
+#ifdef _DICT_THREADSAFE
+// Reader-writer concurrency: every public read method takes a shared lock
+// and every public write method takes an exclusive one, so any number of
+// tasks can serve lookups while a single writer inserts/removes without
+// corrupting an in-flight tree traversal. Readers never block each other
+// (reader-preference "lightswitch": only the first/last reader of a group
+// touches the writer gate). Backed by FreeRTOS semaphores on the ESP32
+// and by std::mutex in host-native builds.
+#if defined(_DICT_COMPRESS) && defined(_DICT_CACHE)
+#error "_DICT_CACHE updates shared state on reads and cannot be combined with _DICT_THREADSAFE"
+#endif
+#if defined(ARDUINO_ARCH_ESP32)
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#elif !defined(ARDUINO)
+#include <mutex>
+#include <condition_variable>
+#else
+#error "_DICT_THREADSAFE requires FreeRTOS (ESP32) or a host-native build"
+#endif
+#endif // _DICT_THREADSAFE
+
+#ifdef _DICT_SSO
+// Small-string optimization: keys/values that fit the inline buffers below
+// (including the _DICT_EXTRA terminator byte) are stored inside the node
+// itself, sharing space with the respective buffer pointer, so short
+// entries cost no separate heap allocations at all
+#ifndef _DICT_SSO_KEY
+#define _DICT_SSO_KEY 16
+#endif
+#ifndef _DICT_SSO_VAL
+#define _DICT_SSO_VAL 8
+#endif
+#endif // _DICT_SSO
+
+#ifdef _DICT_BALANCED
+// Deepest tree insert/delete will ever have to rebalance. An AVL tree of
+// depth 64 would need more nodes than any microcontroller can hold
+// (a worst-case AVL tree of depth 47 already requires 2^32 nodes).
+#define _DICT_MAX_DEPTH 64
+#endif
+
+#ifdef _DICT_ENGINE_HASH
+// Open-addressing hash table engine: replaces the binary search tree with
+// a flat robin hood table of (hash, node*) slots behind the same public
+// API. A lookup is one multiply plus a short linear probe over a
+// contiguous array - one or two cache lines touched - instead of O(log n)
+// dependent pointer chases, and the nodes carry no child pointers.
+// Positional key(i)/value(i) order is arbitrary, exactly as it already is
+// for the tree engine after a removal.
+#ifdef _DICT_BALANCED
+#error "_DICT_BALANCED tunes the tree engine and has no effect with _DICT_ENGINE_HASH"
+#endif
+// the table needs the FULL key hashed: the default first-bytes crc() maps
+// every key sharing a prefix (key0001, key0002, ...) to one slot cluster,
+// degrading probes to O(n)
+#ifndef _DICT_HASH_FNV
+#define _DICT_HASH_FNV
+#endif
+#endif
+
 
-#include <Arduino.h>
 #include "BufferStream/BufferStream.h"
 
 
+#ifdef _DICT_ARENA
+// Pooled arena allocator: all nodes and key/value buffers are carved out
+// of large blocks (PSRAM-backed when _DICT_USE_PSRAM is set), so a single
+// entry costs a pointer bump instead of three heap allocations and
+// long-running insert/remove churn cannot fragment the main heap.
+#ifndef _DICT_ARENA_BLOCK
+#define _DICT_ARENA_BLOCK 4096
+#endif
+
+void*   dict_arena_alloc(size_t size);
+void    dict_arena_free(void* p);
+bool    dict_arena_reserve(size_t bytes);
+#endif // _DICT_ARENA
+
+
+// Per-dictionary allocation policy, selected in the constructor. Only
+// meaningful on an ESP32 with _DICT_USE_PSRAM; elsewhere the argument is
+// accepted and ignored so sketches stay portable.
+#define DICT_ALLOC_PSRAM            0   // PSRAM first, internal heap fallback (historic default)
+#define DICT_ALLOC_INTERNAL         1   // internal heap only - latency-critical tables
+#define DICT_ALLOC_INTERNAL_PSRAM   2   // internal heap first, PSRAM when it runs out
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
+// psramFound() is a non-trivial IDF call and its answer never changes
+// after boot - detect once, on the first allocation
+inline bool _dict_psram_found() {
+    static bool checked = false;
+    static bool found = false;
+
+    if (!checked) {
+        found = psramFound();
+        checked = true;
+    }
+    return found;
+}
+
+// the policy of the dictionary currently executing an allocating method:
+// the allocation helpers are free functions (node::operator new has no
+// owner pointer), so the owner parks its policy here on entry - the same
+// single-writer convention as the iKeyTemp/iValTemp scratch. With
+// _DICT_THREADSAFE, writers into *different* dictionaries may briefly
+// cross-apply policies; every policy still falls back correctly, so the
+// worst case is an allocation landing in the other memory region.
+static uint8_t dictAllocPolicy = DICT_ALLOC_PSRAM;
+#endif
+
+#ifdef _DICT_STATS
+// Instrumentation counters (see DictionaryStats below): cheap increments
+// in the hot paths, read out on demand by stats(). The allocation total
+// lives here because _dict_malloc is a free function shared by every
+// dictionary in the build - the figure is build-wide, like the arena.
+static size_t dictStatsBytes = 0;   // cumulative bytes requested via _dict_malloc
+#endif
+
+// All dictionary objects (nodes, strings, node array) are allocated and
+// freed through these two helpers
+inline void* _dict_malloc(size_t size) {
+#ifdef _DICT_STATS
+    dictStatsBytes += size;
+#endif
+#ifdef _DICT_ARENA
+    return dict_arena_alloc(size);
+#else
+    void* p = NULL;
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
+    if (dictAllocPolicy == DICT_ALLOC_PSRAM && _dict_psram_found()) {
+        p = ps_malloc(size);
+    }
+    if (!p) p = malloc(size);
+    if (!p && dictAllocPolicy == DICT_ALLOC_INTERNAL_PSRAM && _dict_psram_found()) {
+        p = ps_malloc(size);
+    }
+#else
+    p = malloc(size);
+#endif
+    return p;
+#endif // _DICT_ARENA
+}
+
+inline void _dict_free(void* p) {
+#ifdef _DICT_ARENA
+    dict_arena_free(p);
+#else
+    free(p);
+#endif
+}
+
+
 #ifdef _DICT_PACK_STRUCTURES
 class __attribute((__packed__)) node {
 #else
@@ -220,15 +447,10 @@ class node {
 
       void* p = NULL;
       if ( size ) {
-#if defined (ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
-        if (psramFound()) {
-          p = ps_malloc(size);
-        }
-#endif
-        if (!p) p = malloc(size);
+        p = _dict_malloc(size);
 #ifdef _LIBDEBUG_
         Serial.printf("NODE-NEW: size=%d (%d) k/v sizes=%d, %d, ptr=%u\n", size, sizeof(node), sizeof(_DICT_KEY_TYPE), sizeof(_DICT_VAL_TYPE), (uint32_t)p);
-#endif    
+#endif
       }
       return p;
     }
@@ -237,28 +459,56 @@ class node {
       if ( p == NULL ) return;
       node* n = (node*)p;
 
-      // Delete key/value strings
-      if ( n->keybuf ) { 
-        free(n->keybuf);
+      // Delete key/value strings (unless they live inline in the node)
+#ifdef _DICT_SSO
+      if ( !n->keyIsInline() && n->keybuf ) {
+        _dict_free(n->keybuf);
+        n->keybuf = NULL;
+      }
+      if ( !n->valIsInline() && n->valbuf ) {
+          _dict_free(n->valbuf);
+          n->valbuf = NULL;
+      }
+#else
+      if ( n->keybuf ) {
+        _dict_free(n->keybuf);
         n->keybuf = NULL;
       }
       if ( n->valbuf ) {
-          free(n->valbuf);
+          _dict_free(n->valbuf);
           n->valbuf = NULL;
       }
-      free(p);
+#endif
+      _dict_free(p);
 #ifdef _LIBDEBUG_
       Serial.printf("NODE-DELETE: Freed memory block %u\n", (uint32_t)p);
-#endif    
+#endif
     }
 
     uintNN_t    key() {
+#ifdef _DICT_HASH_FNV
+        // the hash cannot be recovered from keybuf - it is stored in the
+        // node by Dictionary when the node is created or its key changes
+        return hkey;
+#else
         uintNN_t k = 0;
-        
-        memcpy((void*)&k, keybuf, ksize < sizeof(uintNN_t) ? ksize : sizeof(uintNN_t));
+
+        memcpy((void*)&k, keyptr(), ksize < sizeof(uintNN_t) ? ksize : sizeof(uintNN_t));
         return k;
+#endif
     }
-    
+
+#ifdef _DICT_SSO
+    // key storage is padded to sizeof(uintNN_t), same as in create()
+    inline bool keyIsInline() { return (_DICT_KEY_TYPE)( ksize < sizeof(uintNN_t) ? sizeof(uintNN_t) : ksize ) + _DICT_EXTRA <= _DICT_SSO_KEY; }
+    inline bool valIsInline() { return vsize + _DICT_EXTRA <= _DICT_SSO_VAL; }
+    inline char* keyptr() { return keyIsInline() ? keyinl : keybuf; }
+    inline char* valptr() { return valIsInline() ? valinl : valbuf; }
+#else
+    inline char* keyptr() { return keybuf; }
+    inline char* valptr() { return valbuf; }
+#endif
+
     int8_t      create(const char* aKey, _DICT_KEY_TYPE aKeySize, const char* aVal, _DICT_VAL_TYPE aValSize, node* aLeft, node* aRight);
     int8_t      updateValue(const char* aVal, _DICT_VAL_TYPE aValSize);
     int8_t      updateKey(const char* aKey, _DICT_KEY_TYPE aKeySize);
@@ -266,12 +516,41 @@ class node {
 #ifdef _LIBDEBUG_
     void printNode();
 #endif
+#ifdef _DICT_SSO
+    union {
+        char*       keybuf;
+        char        keyinl[_DICT_SSO_KEY];
+    };
+    _DICT_KEY_TYPE  ksize;
+    union {
+        char*       valbuf;
+        char        valinl[_DICT_SSO_VAL];
+    };
+    _DICT_VAL_TYPE  vsize;
+#else
     char*           keybuf;
     _DICT_KEY_TYPE  ksize;
     char*           valbuf;
     _DICT_VAL_TYPE  vsize;
+#endif
+#ifndef _DICT_ENGINE_HASH
     node*           left;
     node*           right;
+#endif
+    size_t          qidx;   // index of this node in the NodeArray (for O(1) removal)
+#ifdef _DICT_COMPRESS
+    // plain-text lengths of the stored (compressed) key and value, so the
+    // running size counters can be adjusted on delete/update without
+    // decompressing the entry again
+    _DICT_KEY_TYPE  kplain;
+    _DICT_VAL_TYPE  vplain;
+#endif
+#ifdef _DICT_HASH_FNV
+    uintNN_t        hkey;   // FNV-1a hash of the full key string
+#endif
+#ifdef _DICT_BALANCED
+    int8_t          hgt;    // height of the subtree rooted at this node (AVL balancing)
+#endif
 };
 
 #ifdef _DICT_PACK_STRUCTURES
@@ -289,9 +568,16 @@ class NodeArray {
     // add an item to the queue.
     int8_t append(const node* i);
 
+    // grow the backing array to hold at least s items in one
+    // reallocation (never shrinks).
+    int8_t reserve(const size_t s);
+
     // remove an item from the queue.
     void remove(const node* i);
 
+    // drop all items and release the storage (back to post-constructor state).
+    void clear();
+
     // check if the queue is empty.
     bool isEmpty() const;
 
@@ -302,7 +588,7 @@ class NodeArray {
     bool isFull() const;
 
 
-    node* operator [] (const size_t i) {
+    node* operator [] (const size_t i) const {
       if (i >= items) {
         //        exit ("QUEUE: Out of bounds");
         return NULL;
@@ -314,6 +600,10 @@ class NodeArray {
     void printArray();
 #endif
 
+#ifdef _DICT_STATS
+    uint32_t resizes;   // times the backing array was reallocated (cumulative)
+#endif
+
   private:
     // resize the size of the queue.
     int8_t resize(const size_t s);
@@ -332,6 +622,48 @@ class NodeArray {
 };
 
 
+#ifdef _DICT_ENGINE_HASH
+// One open-addressing slot. The entry hash sits next to the node pointer
+// so a probe usually decides on the hash alone and only dereferences the
+// node to confirm the key bytes on a likely match.
+#ifdef _DICT_PACK_STRUCTURES
+struct __attribute((__packed__)) hslot {
+#else
+struct hslot {
+#endif
+    uintNN_t    h;
+    node*       n;      // NULL marks an empty slot
+};
+#endif // _DICT_ENGINE_HASH
+
+
+#ifdef _DICT_STATS
+// Snapshot of the instrumentation counters, returned by stats(). The
+// depth fields describe the structure as of the call: node depths for
+// the tree engine, probe chain lengths for _DICT_ENGINE_HASH. The
+// comparison/resize counters are cumulative since construction (or the
+// last statsReset()); bytesAllocated is cumulative for the whole build.
+struct DictionaryStats {
+    size_t      entries;        // count() at the time of the call
+    size_t      maxDepth;       // deepest node / longest probe chain
+    float       avgDepth;       // average over all entries
+    uint32_t    searchCmps;     // comparison steps taken by lookups
+    uint32_t    insertCmps;     // comparison steps taken by insert descents
+    uint32_t    resizes;        // NodeArray reallocations (+ table rehashes)
+    size_t      bytesAllocated; // bytes requested via _dict_malloc, build-wide
+};
+#endif // _DICT_STATS
+
+
+// expand to scoped lock guards inside Dictionary methods when the
+// reader-writer mode is on, and to nothing otherwise
+#ifdef _DICT_THREADSAFE
+#define _DICT_RLOCK     Dictionary::ReadGuard  _dict_rg(*this)
+#define _DICT_WLOCK     Dictionary::WriteGuard _dict_wg(*this)
+#else
+#define _DICT_RLOCK
+#define _DICT_WLOCK
+#endif
 
 #ifdef _DICT_PACK_STRUCTURES
 class __attribute((__packed__)) Dictionary {
@@ -339,7 +671,7 @@ class __attribute((__packed__)) Dictionary {
 class Dictionary {
 #endif
   public:
-    Dictionary(size_t init_size = 10);
+    Dictionary(size_t init_size = 10, uint8_t alloc_policy = DICT_ALLOC_PSRAM);
     ~Dictionary();
 
     inline int8_t       insert(String keystr, int32_t val) { return insert( keystr, String(val) ); }
@@ -348,44 +680,103 @@ class Dictionary {
     inline int8_t       insert(String keystr, String  valstr)  { return insert( keystr.c_str(), valstr.c_str() ); }
     int8_t              insert(const char* keystr, const char* valstr);
     
-    inline String       search(const String& keystr) { return search(keystr.c_str()); }
-    String              search(const char* keystr);
-    String              key(size_t i);
-    String              value(size_t i);
+    inline String       search(const String& keystr) const { return search(keystr.c_str()); }
+    String              search(const char* keystr) const;
+    inline const char*  get(const String& keystr, size_t* vallen = NULL) { return get(keystr.c_str(), vallen); }
+    const char*         get(const char* keystr, size_t* vallen = NULL);
+    String              key(size_t i) const;
+    String              value(size_t i) const;
+
+    // Walk every entry without building a single String: the callback is
+    // invoked as cb(key, keylen, value, vallen) with plain-text const
+    // char* pointers, decompressed at most once per entry; the pointers
+    // are only valid for the duration of the call. Return false from the
+    // callback to stop early. Entries come in key(i)/value(i) order;
+    // returns the number of entries visited. Accepts function pointers
+    // and (capturing) lambdas alike.
+    template<typename F> size_t forEach(F cb) const;
+
+    // Same callback contract as forEach(), restricted to keys starting
+    // with prefix / lexicographically between lo and hi (inclusive).
+    // Returns the number of matches visited. How much work is skipped
+    // depends on the build - see "Prefix and range queries" in README.
+    template<typename F> size_t forEachPrefix(const char* prefix, F cb) const;
+    template<typename F> size_t forEachRange(const char* lo, const char* hi, F cb) const;
 
     void                destroy();
     inline int8_t       remove(const String& keystr);
     int8_t              remove(const char* keystr);
 
-    size_t              size();
-    size_t              jsize();
-    size_t              esize();
-    
-    String              json();
+    // all three size queries return in O(1) from running counters that are
+    // maintained incrementally on every insert/update/remove
+    size_t              size() const;
+    size_t              jsize() const;
+    size_t              esize() const;
+
+    String              json() const;
+    size_t              jsonTo (Stream& out) const;
     int8_t              jload (const String& json, int aNum = 0);
     int8_t              jload (Stream& json, int aNum = 0);
-    int8_t              merge (Dictionary& dict);
-
-
-    void operator = (Dictionary& dict) {
+    int8_t              save (Stream& out) const;
+    int8_t              load (Stream& in);
+    int8_t              merge (const Dictionary& dict);
+    int8_t              merge (Dictionary&& dict);
+    int8_t              build (const char* const* keys, const char* const* vals, size_t n);
+
+    // Pre-size the storage ahead of a bulk load: the node array (and the
+    // hash table, when that engine is compiled in) grow to their final
+    // size in one step instead of reallocating over and over as entries
+    // arrive. avgKeyLen/avgValLen are optional hints that pre-charge the
+    // arena allocator (_DICT_ARENA) with one block big enough for the
+    // whole load; they are ignored in plain-heap builds, where individual
+    // strings cannot be meaningfully preallocated.
+    int8_t              reserve (size_t entries, size_t avgKeyLen = 0, size_t avgValLen = 0);
+
+    // O(1) content exchange / wholesale takeover - no entry is ever
+    // copied, decompressed or reallocated (see the move semantics section)
+    void                swap (Dictionary& dict);
+    void                adopt (Dictionary&& dict);
+
+    void operator = (const Dictionary& dict) {
       destroy();
       merge(dict);
     }
 
-    inline String operator [] (const String& keystr) { return search(keystr); }
-    inline String operator [] (size_t i) { return value(i); }
+    void operator = (Dictionary&& dict) {
+      adopt(static_cast<Dictionary&&>(dict));
+    }
+
+    inline String operator [] (const String& keystr) const { return search(keystr); }
+    inline String operator [] (size_t i) const { return value(i); }
     inline int8_t operator () (String keystr, int32_t val) { return insert(keystr, val); }
     inline int8_t operator () (String keystr, float val) { return insert(keystr, val); }
     inline int8_t operator () (String keystr, double val) { return insert(keystr, val); }
     inline int8_t operator () (String keystr, String valstr) { return insert(keystr, valstr); }
     inline int8_t operator () (const char* keystr, const char* valstr) { return insert(keystr, valstr); }
 
-    bool operator () (const String& keystr);
-
-    String operator () (size_t i) { return key(i); }
-    bool operator == (Dictionary& b);
-    inline bool operator != (Dictionary& b) { return (!(*this == b)); }
-    inline size_t count() { return ( Q ? Q->count() : 0); }
+    bool operator () (const String& keystr) const;
+
+    String operator () (size_t i) const { return key(i); }
+    bool operator == (const Dictionary& b) const;
+    inline bool operator != (const Dictionary& b) const { return (!(*this == b)); }
+    // deliberately unlocked even with _DICT_THREADSAFE: a single size_t
+    // read (Q itself never moves), and the write-locked methods call it
+    inline size_t count() const { return ( Q ? Q->count() : 0); }
+
+    // order-independent content fingerprint, maintained incrementally on
+    // every insert/update/remove: equal content means equal fingerprints,
+    // so "has anything changed since the last save?" polls are O(1)
+    // (compare against a remembered fingerprint, or another dictionary's)
+    inline uint32_t fingerprint() const { return iFP; }
+
+#ifdef _DICT_STATS
+    // instrumentation snapshot for telemetry: tells whether lookups are
+    // slow because the tree degenerated (or probe chains clustered)
+    // without the _LIBDEBUG_ Serial spam. Walks the structure to measure
+    // depth - a diagnostic call, not a hot one.
+    DictionaryStats stats() const;
+    void            statsReset();   // zero the cumulative counters
+#endif
 
 #ifdef _LIBDEBUG_
     void printNode(node* root);
@@ -402,31 +793,215 @@ class Dictionary {
 
   private:
 // methods
-    int8_t              insert(uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen, const char* valstr, _DICT_VAL_TYPE vallen, node* leaf);
-    node*               search(uintNN_t key, node* leaf, const char* keystr, _DICT_KEY_TYPE keylen);
+    int8_t              insert(uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen, const char* valstr, _DICT_VAL_TYPE vallen, node*& root);
+    node*               search(uintNN_t key, node* leaf, const char* keystr, _DICT_KEY_TYPE keylen) const;
+    node*               lookupNode(const char* keystr) const;
+    const char*         valueOf(node* p, char* aBuf, _DICT_VAL_TYPE& aLen) const;
 
-    void                destroy_tree(node* leaf);
     node*               deleteNode(node* root, uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen);
+
+    int8_t              appendNode(uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen, const char* valstr, _DICT_VAL_TYPE vallen);
+    int8_t              rebuild();
+
+#ifdef _DICT_ENGINE_HASH
+    size_t              homeSlot(uintNN_t h) const;
+    size_t              tableFind(uintNN_t key, const char* keystr, _DICT_KEY_TYPE keylen) const;
+    void                tablePlace(uintNN_t h, node* p);
+    int8_t              tableRehash(size_t aMin);
+#else
     node*               minValueNode(node* n);
+    node*               buildSubtree(node* const* arr, size_t lo, size_t hi);
+#endif
 
-    uintNN_t            crc(const void* data, size_t n_bytes);
+#ifdef _DICT_BALANCED
+    inline int8_t       height(node* n) { return ( n ? n->hgt : 0 ); }
+    void                updateHeight(node* n);
+    node*               rotateLeft(node* n);
+    node*               rotateRight(node* n);
+    node*               rebalance(node* n);
+#endif
+
+    uintNN_t            crc(const void* data, size_t n_bytes) const;
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
+    // park this dictionary's policy for the free-function allocation
+    // helpers; called on entry of every allocating method
+    inline void         applyAllocPolicy() const { dictAllocPolicy = iAllocPolicy; }
+#else
+    inline void         applyAllocPolicy() const {}
+#endif
 
 #ifdef _DICT_COMPRESS
-    int8_t              compressKey(const char* aStr);
-    int8_t              compressValue(const char* aStr);
-    void                decompressKey(const char* aBuf, _DICT_KEY_TYPE aLen);
-    void                decompressValue(const char* aBuf, _DICT_VAL_TYPE aLen);
+    // the writer-path methods fill the shared iKeyTemp/iValTemp scratch;
+    // the *To variants write into caller-provided buffers and keep the
+    // read path free of shared state (reentrant const lookups)
+    int8_t              compressKey(const char* aStr, size_t aLen);
+    int8_t              compressValue(const char* aStr, size_t aLen);
+    int8_t              compressKeyTo(const char* aStr, size_t aLen, char* aOut, _DICT_KEY_TYPE& aOutLen) const;
+    _DICT_KEY_TYPE      decompressKeyTo(const char* aBuf, _DICT_KEY_TYPE aLen, char* aOut) const;
+    _DICT_VAL_TYPE      decompressValueTo(const char* aBuf, _DICT_VAL_TYPE aLen, char* aOut) const;
+#endif
+
+#if defined(_DICT_COMPRESS) && defined(_DICT_CACHE)
+    char*               cachedValue(node* p, _DICT_VAL_TYPE& aLen) const;
+#endif
+
+#if defined(_DICT_COMPRESS) && defined(_DICT_CACHE)
+    void                cacheInvalidate(node* p);
+    void                cacheClear();
+#else
+    inline void         cacheInvalidate(node*) {}
+    inline void         cacheClear() {}
+#endif
+
+#ifdef _DICT_THREADSAFE
+    // "lightswitch" reader-writer lock: the first reader of a group takes
+    // the writer gate, the last one gives it back; a writer holds the gate
+    // exclusively. Nested read locks on the same task are safe (only the
+    // first lock of the group touches the gate), which lets json()/
+    // operator== call the locked key()/value()/search() internally.
+    void rlock() const {
+#if defined(ARDUINO_ARCH_ESP32)
+        xSemaphoreTake(iRWMutex, portMAX_DELAY);
+        if (++iReaders == 1) xSemaphoreTake(iRWGate, portMAX_DELAY);
+        xSemaphoreGive(iRWMutex);
+#else
+        // std::mutex may not be released from another thread, so the host
+        // build uses a condition variable instead of the semaphore gate
+        std::unique_lock<std::mutex> l(iRWMutex);
+        while (iWriter) iRWCond.wait(l);
+        ++iReaders;
+#endif
+    }
+    void runlock() const {
+#if defined(ARDUINO_ARCH_ESP32)
+        xSemaphoreTake(iRWMutex, portMAX_DELAY);
+        if (--iReaders == 0) xSemaphoreGive(iRWGate);
+        xSemaphoreGive(iRWMutex);
+#else
+        std::unique_lock<std::mutex> l(iRWMutex);
+        if (--iReaders == 0) iRWCond.notify_all();
+#endif
+    }
+    void wlock() const {
+#if defined(ARDUINO_ARCH_ESP32)
+        xSemaphoreTake(iRWGate, portMAX_DELAY);
+#else
+        std::unique_lock<std::mutex> l(iRWMutex);
+        while (iWriter || iReaders != 0) iRWCond.wait(l);
+        iWriter = true;
+#endif
+    }
+    void wunlock() const {
+#if defined(ARDUINO_ARCH_ESP32)
+        xSemaphoreGive(iRWGate);
+#else
+        std::unique_lock<std::mutex> l(iRWMutex);
+        iWriter = false;
+        iRWCond.notify_all();
 #endif
+    }
+    struct ReadGuard {
+        const Dictionary& d;
+        ReadGuard(const Dictionary& a) : d(a) { d.rlock(); }
+        ~ReadGuard() { d.runlock(); }
+    };
+    struct WriteGuard {
+        const Dictionary& d;
+        WriteGuard(const Dictionary& a) : d(a) { d.wlock(); }
+        ~WriteGuard() { d.wunlock(); }
+    };
+#endif // _DICT_THREADSAFE
 
 // data
-    node*               iRoot;
+    node*               iRoot;      // stays NULL with _DICT_ENGINE_HASH
+#ifdef _DICT_ENGINE_HASH
+    hslot*              iTable;     // power-of-two array of open-addressing slots
+    size_t              iCap;       // slot count (0 until the first insert)
+#endif
     NodeArray*          Q;
     size_t              initSize;
+#if defined(ARDUINO_ARCH_ESP32) && defined(_DICT_USE_PSRAM)
+    uint8_t             iAllocPolicy;   // DICT_ALLOC_* choice for this dictionary
+#endif
+    uint32_t            iFP;        // XOR of per-entry content hashes
+    size_t              iSize;      // running sum of stored key+value bytes
+#ifdef _DICT_STATS
+    // plain increments, no atomics: with _DICT_THREADSAFE concurrent
+    // readers may lose the occasional tick - these are diagnostics,
+    // not exact accounting. mutable: lookups are const.
+    mutable uint32_t    iSearchCmps;
+    mutable uint32_t    iInsertCmps;
+#ifdef _DICT_ENGINE_HASH
+    uint32_t            iRehashes;  // reported together with NodeArray resizes
+#endif
+#endif
+#ifdef _DICT_COMPRESS
+    size_t              iPlainSize; // running sum of plain-text key+value lengths
+    _DICT_KEY_TYPE      iKeyPlain;  // plain-text lengths of the pair currently
+    _DICT_VAL_TYPE      iValPlain;  // held in the iKeyTemp/iValTemp scratch
+#endif
 
     char*               iKeyTemp;
     _DICT_KEY_TYPE      iKeyLen;
     char*               iValTemp;
     _DICT_VAL_TYPE      iValLen;
+
+#if defined(_DICT_COMPRESS) && defined(_DICT_CACHE)
+    // most recently used entry first; buffers are pooled (allocated on
+    // first use, reused across evictions, freed in the destructor).
+    // mutable: the LRU bookkeeping runs inside const lookups - NOTE that
+    // this makes reads non-reentrant, see README
+    mutable struct {
+        node*           nd;
+        char*           val;
+        _DICT_VAL_TYPE  len;
+    }                   iCache[_DICT_CACHE_SIZE];
+#endif
+
+#ifdef _DICT_THREADSAFE
+#if defined(ARDUINO_ARCH_ESP32)
+    mutable SemaphoreHandle_t   iRWMutex;   // protects iReaders
+    mutable SemaphoreHandle_t   iRWGate;    // held by the writer or the reader group
+#else
+    mutable std::mutex              iRWMutex;
+    mutable std::condition_variable iRWCond;
+    mutable bool                    iWriter;
+#endif
+    mutable uint16_t            iReaders;
+#endif
+};
+
+// Resumable JSON loader: holds the jload() parser state (a few flags and
+// the partial key/value) between calls, so a document arriving over a
+// slow Stream can be consumed a few bytes per loop() iteration without
+// ever blocking. Completed pairs are inserted into the dictionary as
+// they close; feed() returns DICTIONARY_AGAIN when the input ran dry
+// mid-document, DICTIONARY_OK once the closing '}' has been seen, or an
+// error code. For brace-less line-format documents call end() when the
+// transport signals completion. jload() itself runs on this class.
+class JsonLoader {
+  public:
+    JsonLoader(Dictionary& aDict) : iDict(aDict) { reset(); }
+
+    void    reset();
+    int8_t  feed(Stream& json, size_t aMaxChars = 0);
+    int8_t  feed(const char* aBuf, size_t aLen);
+    int8_t  consume(char c);
+    int8_t  end();
+    inline size_t pairs() const { return iPairs; }  // pairs inserted so far
+
+  private:
+    Dictionary& iDict;
+    char        iKey[_DICT_KEYLEN + 1];
+    char        iVal[_DICT_VALLEN + 1];
+    size_t      iKeyLen;
+    size_t      iValLen;
+    size_t      iPairs;
+    bool        iInsideQuote;
+    bool        iNextVerbatim;
+    bool        iIsValue;
+    bool        iIsComment;
 };
 
 #endif // #define _DICTIONARY_H_
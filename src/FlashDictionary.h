@@ -0,0 +1,125 @@
+/*
+  Read-only companion of the Dictionary data type: a key-value table
+  generated offline (see extras/host/dictgen) and compiled straight into
+  program flash. Lookups answer by binary search over the flash-resident
+  table - zero heap, zero RAM copies, zero startup parsing.
+
+  ---
+
+  Copyright (C) Anatoli Arkhipenko, 2020
+  All rights reserved.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef _FLASH_DICTIONARY_H_
+#define _FLASH_DICTIONARY_H_
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "Host/HostArduino.h"  // host-native build for profiling/fuzzing
+#endif
+
+// Generated headers provide three things: the data blob (all keys and
+// values, each null-terminated, in key order), the entry table (offsets
+// into the blob) and a FlashDictionary object tying them together. Both
+// arrays live in PROGMEM; the object itself is a few pointers.
+//
+// The read API mirrors class Dictionary: search() / operator[] /
+// operator() / key(i) / value(i) / get() / count().
+
+class FlashDictionary {
+  public:
+    // one table row: byte offsets of a key and its value inside the data
+    // blob; the table is sorted by the key strings (plain strcmp order)
+    struct entry {
+        uint32_t    key;
+        uint32_t    val;
+    };
+
+    constexpr FlashDictionary(const entry* aEntries, const char* aData, size_t aCount)
+        : iEntries(aEntries), iData(aData), iCount(aCount) {}
+
+    String search(const char* keystr) const {
+        int32_t i = find(keystr);
+        return ( i < 0 ? String("") : value((size_t)i) );
+    }
+    inline String search(const String& keystr) const { return search(keystr.c_str()); }
+
+    // zero-copy lookup: returns a pointer straight into flash. Fine to
+    // dereference on memory-mapped flash (ESP32/ESP8266/host); on AVR
+    // read it with the pgmspace functions (strcpy_P and friends)
+    const char* get(const char* keystr, size_t* vallen = NULL) const {
+        int32_t i = find(keystr);
+        if (i < 0) return NULL;
+
+        const char* v = iData + entryAt((size_t)i).val;
+        if (vallen) *vallen = strlen_P(v);
+        return v;
+    }
+    inline const char* get(const String& keystr, size_t* vallen = NULL) const { return get(keystr.c_str(), vallen); }
+
+    String key(size_t i) const {
+        return ( i < iCount ? flashString(iData + entryAt(i).key) : String() );
+    }
+    String value(size_t i) const {
+        return ( i < iCount ? flashString(iData + entryAt(i).val) : String() );
+    }
+
+    inline String operator [] (const String& keystr) const { return search(keystr); }
+    inline String operator [] (size_t i) const { return value(i); }
+    inline bool   operator () (const String& keystr) const { return find(keystr.c_str()) >= 0; }
+    inline String operator () (size_t i) const { return key(i); }
+    inline size_t count() const { return iCount; }
+
+  private:
+    // the entry table is in PROGMEM - fetch a row into RAM before use
+    // (a no-op copy everywhere but on Harvard-architecture AVRs)
+    entry entryAt(size_t i) const {
+        entry e;
+        memcpy_P(&e, &iEntries[i], sizeof(entry));
+        return e;
+    }
+
+    static String flashString(const char* p) {
+#ifdef ARDUINO
+        return String(reinterpret_cast<const __FlashStringHelper*>(p));
+#else
+        return String(p);
+#endif
+    }
+
+    int32_t find(const char* keystr) const {
+        size_t lo = 0;
+        size_t hi = iCount;
+
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            int c = strcmp_P(keystr, iData + entryAt(mid).key);
+
+            if (c == 0) return (int32_t)mid;
+            if (c < 0) hi = mid;
+            else       lo = mid + 1;
+        }
+        return -1;
+    }
+
+    const entry*    iEntries;
+    const char*     iData;
+    size_t          iCount;
+};
+
+#endif // _FLASH_DICTIONARY_H_
@@ -0,0 +1,147 @@
+/*
+
+  Minimal host-side replacement for <Arduino.h> - just enough of the
+  String / Print / Stream API for the Dictionary library to compile and
+  run natively on a desktop OS, so search/insert/jload can be profiled
+  with real tooling (perf, valgrind, sanitizers, fuzzers).
+
+  Only used when ARDUINO is not defined; on a real board the genuine
+  core headers are included instead. See extras/host/ for a CMake
+  project building the library this way.
+
+*/
+
+#ifndef _DICT_HOST_ARDUINO_H_
+#define _DICT_HOST_ARDUINO_H_
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <string>
+
+class String {
+  public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(char c) : s_(1, c) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    String(float v) { char b[33]; snprintf(b, sizeof(b), "%.2f", v); s_ = b; }
+    String(double v) { char b[33]; snprintf(b, sizeof(b), "%.2f", v); s_ = b; }
+
+    size_t length() const { return s_.size(); }
+    const char* c_str() const { return s_.c_str(); }
+    void reserve(size_t n) { s_.reserve(n); }
+    bool concat(char c) { s_.push_back(c); return true; }
+    bool concat(const char* s) { s_.append(s); return true; }
+    void replace(const char* what, const char* with) {
+        std::string f(what), r(with);
+        size_t pos = 0;
+        while ((pos = s_.find(f, pos)) != std::string::npos) {
+            s_.replace(pos, f.size(), r);
+            pos += r.size();
+        }
+    }
+    char operator[](size_t i) const { return s_[i]; }
+    String& operator+=(char c) { s_.push_back(c); return *this; }
+    String& operator+=(const char* s) { s_.append(s); return *this; }
+    String& operator+=(const String& o) { s_.append(o.s_); return *this; }
+    friend String operator+(String a, const String& b) { a += b; return a; }
+    friend String operator+(String a, const char* b) { a += b; return a; }
+    friend String operator+(String a, char b) { a += b; return a; }
+    friend String operator+(const char* a, const String& b) { return String(a) + b; }
+    friend String operator+(char a, const String& b) { return String(a) + b; }
+    bool operator==(const String& o) const { return s_ == o.s_; }
+    bool operator==(const char* o) const { return s_ == (o ? o : ""); }
+    bool operator!=(const String& o) const { return s_ != o.s_; }
+    bool operator!=(const char* o) const { return s_ != (o ? o : ""); }
+    long toInt() const { return atol(s_.c_str()); }
+
+  private:
+    std::string s_;
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len) {
+        size_t n = 0;
+        while (len--) n += write(*buf++);
+        return n;
+    }
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(float v) { return print(String(v)); }
+    size_t print(double v) { return print(String(v)); }
+    size_t println() { return write((uint8_t)'\n'); }
+    template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    size_t printf(const char* fmt, ...) {
+        char buf[512];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n > 0) print(buf);
+        return n > 0 ? (size_t)n : 0;
+    }
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+    size_t readBytes(uint8_t* buf, size_t len) {
+        size_t n = 0;
+        int c;
+        while (n < len && (c = read()) >= 0) buf[n++] = (uint8_t)c;
+        return n;
+    }
+    size_t readBytes(char* buf, size_t len) { return readBytes((uint8_t*)buf, len); }
+};
+
+class HardwareSerial : public Stream {
+  public:
+    virtual size_t write(uint8_t c) { fputc(c, stdout); return 1; }
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    void begin(unsigned long) {}
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// flash on a desktop machine is just memory
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#ifndef strcmp_P
+#define strcmp_P    strcmp
+#endif
+#ifndef strlen_P
+#define strlen_P    strlen
+#endif
+#ifndef memcpy_P
+#define memcpy_P    memcpy
+#endif
+
+#endif // ARDUINO
+
+#endif // _DICT_HOST_ARDUINO_H_
@@ -91,9 +91,9 @@ size_t shoco_compress(const char * const shoco_restrict original, size_t strlen,
   unsigned int rest;
   const char * const in_end = original + strlen;
 
-  while ((*in != '\0')) {
-    if (strlen && (in == in_end))
-      break;
+  // when the caller passes the length, trust it and skip the per-character
+  // null checks; with strlen == 0 the input is scanned as a C string
+  while (strlen ? (in != in_end) : (*in != '\0')) {
 
     // find the longest string of known successors
     indices[0] = chr_ids_by_chr[(unsigned char)in[0]];
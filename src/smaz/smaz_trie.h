@@ -0,0 +1,116 @@
+/* smaz_trie.h -- generated by extras/host/smazgen, do not edit.
+ *
+ * Prefix trie over the smaz reverse codebook: Smaz_trie_root indexes
+ * the depth-1 node by first byte (-1 = no codebook string starts
+ * with it), deeper levels are first-child/next-sibling chains. A
+ * node's code is the codebook byte for the string ending there
+ * (0xFF = none; real codes stop at 0xFD, 0xFE/0xFF are the verbatim
+ * escapes). Codebook strings are unique, so the longest trie match
+ * is exactly the entry the original hash-probing encoder found -
+ * the compressed output is byte-identical.
+ */
+#ifndef _SMAZ_TRIE_H_
+#define _SMAZ_TRIE_H_
+
+#define SMAZ_TRIE_MAX 7  /* longest codebook string */
+
+typedef struct {
+    unsigned char ch;     /* byte on the edge from the parent */
+    unsigned char code;   /* codebook byte emitted here, 0xFF = none */
+    short         first;  /* first child, -1 = leaf */
+    short         next;   /* next sibling, -1 = last */
+} SmazTrieNode;
+
+static const short Smaz_trie_root[256] = {
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  58,  -1,  -1,  23,  -1,  -1,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+       1,  -1, 121,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  38, 229, 132, 221,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1, 249, 194, 246,  -1,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+      -1,  -1,  -1,  -1,  86,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+      -1,   6, 107,  30,  27,   5,  52,  67,  19,  11,  -1,  -1,  25,  53,  12,   7,
+      68,  -1,  15,  13,   2,  41, 131,  47, 273,  84, 244,  -1,  -1,  -1,  -1,  -1,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+      -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+};
+
+static const SmazTrieNode Smaz_trie[279] = {
+    {0x00,0xff,   1,  -1}, {0x20,0x00,  16,   2}, {0x74,0x03,   3,   5}, {0x68,0x11,   4,  22}, 
+    {0x65,0x01, 119,  56}, {0x65,0x02,  14,   6}, {0x61,0x04,   9,   7}, {0x6f,0x06,   8,  11}, 
+    {0x66,0x05,  36,  33}, {0x6e,0x1a,  10,  42}, {0x64,0x07,  -1,  -1}, {0x69,0x08,  18,  12}, 
+    {0x6e,0x09,  45,  13}, {0x73,0x0a,  26,  15}, {0x20,0x0b, 179,  29}, {0x72,0x0c,  35,  19}, 
+    {0x74,0x0e,  17,  28}, {0x68,0x0d,  -1,  98}, {0x6e,0x0f,  83,  40}, {0x68,0x12,  20,  23}, 
+    {0x65,0x10,  21,  74}, {0x20,0x13,  -1, 144}, {0x6f,0x14, 106,  37}, {0x0d,0x39,  24,  25}, 
+    {0x0a,0x15, 193,  -1}, {0x6c,0x16, 104,  27}, {0x20,0x17, 171,  94}, {0x64,0x18,  32,  30}, 
+    {0x61,0x19,  64,  31}, {0x72,0x1b, 146,  61}, {0x63,0x1c, 139,  38}, {0x6f,0x1d,  34,  43}, 
+    {0x20,0x1e, 158, 127}, {0x6e,0x1f, 166,  46}, {0x66,0x20,  -1, 228}, {0x65,0x21, 135,  91}, 
+    {0x20,0x22,  -1,  -1}, {0x20,0x23, 201,  82}, {0x2c,0x51,  39,  41}, {0x20,0x24, 170,  -1}, 
+    {0x73,0x25, 138,  55}, {0x75,0x26, 172,  47}, {0x74,0x27, 159,  54}, {0x20,0x34,  44,  62}, 
+    {0x20,0x28,  -1,  -1}, {0x20,0x29, 167,  69}, {0x72,0x2a, 202, 108}, {0x77,0x41,  48,  52}, 
+    {0x68,0xc2,  49,  59}, {0x69,0xf7,  50, 242}, {0x63,0xff,  51,  -1}, {0x68,0x2b,  -1,  -1}, 
+    {0x66,0x2c,  66,  53}, {0x6d,0x2d, 130,  58}, {0x73,0x2e, 164,  96}, {0x74,0x2f, 243, 128}, 
+    {0x61,0xcb,  57, 177}, {0x74,0x30,  -1,  -1}, {0x0a,0x31, 191,  67}, {0x61,0xd6,  60, 101}, 
+    {0x73,0x32,  -1,  -1}, {0x6e,0x33, 116,  63}, {0x77,0x35, 183,  65}, {0x73,0x36, 148,  72}, 
+    {0x6e,0x37,  -1, 168}, {0x69,0x38,  95,  70}, {0x20,0x3a, 140,  80}, {0x67,0x3b, 180,  68}, 
+    {0x70,0x3c, 233,  84}, {0x64,0x3d,  71,  97}, {0x73,0x3e,  -1,  89}, {0x20,0x3f,  -1,  -1}, 
+    {0x64,0x42,  73, 142}, {0x20,0x40,  -1,  -1}, {0x74,0xff,  75,  92}, {0x74,0xff,  76,  -1}, 
+    {0x70,0xff,  77,  -1}, {0x3a,0xff,  78,  -1}, {0x2f,0xff,  79,  -1}, {0x2f,0x43,  -1,  -1}, 
+    {0x6f,0xdc,  81, 122}, {0x72,0x44,  -1,  -1}, {0x65,0x45, 209,  90}, {0x67,0x46,  -1, 126}, 
+    {0x79,0x53,  85,  86}, {0x20,0x47,  -1,  -1}, {0x54,0xff,  87, 107}, {0x68,0xff,  88,  -1}, 
+    {0x65,0x48,  -1,  -1}, {0x63,0x49, 185, 100}, {0x69,0x4a, 165, 219}, {0x20,0x4b,  -1, 136}, 
+    {0x69,0x66,  93, 117}, {0x73,0x4c,  -1,  -1}, {0x74,0x4d,  -1, 114}, {0x6e,0x4e,  -1, 270}, 
+    {0x72,0x4f, 141, 105}, {0x74,0x50,  -1,  99}, {0x6f,0x52,  -1,  -1}, {0x67,0x54, 118, 154}, 
+    {0x68,0x55, 227, 113}, {0x69,0xff, 102, 110}, {0x74,0xff, 103,  -1}, {0x68,0x56,  -1,  -1}, 
+    {0x65,0x57,  -1, 161}, {0x6c,0x58, 134, 187}, {0x20,0x59,  -1,  -1}, {0x62,0x5a, 109, 121}, 
+    {0x75,0x5b, 241, 115}, {0x65,0x5c,  -1, 149}, {0x65,0x91, 111,  -1}, {0x72,0xff, 112,  -1}, 
+    {0x65,0x5d,  -1,  -1}, {0x62,0x5e, 196, 125}, {0x65,0x5f,  -1, 156}, {0x20,0x60,  -1, 169}, 
+    {0x74,0x61,  -1, 232}, {0x61,0x62, 176, 162}, {0x20,0x63,  -1,  -1}, {0x69,0xff, 120, 150}, 
+    {0x72,0x64,  -1,  -1}, {0x22,0x65,  -1, 131}, {0x72,0xff, 123,  -1}, {0x6f,0xff, 124,  -1}, 
+    {0x6d,0x67,  -1,  -1}, {0x66,0x68, 239, 145}, {0x20,0x69,  -1,  -1}, {0x65,0x6a,  -1, 151}, 
+    {0x6f,0x90, 129, 153}, {0x6e,0x6b,  -1,  -1}, {0x65,0x6c, 275, 199}, {0x76,0x6d, 133, 132}, 
+    {0x2e,0x6e, 143, 194}, {0x65,0x6f, 255,  -1}, {0x6c,0x70,  -1,  -1}, {0x20,0x71,  -1,  -1}, 
+    {0x69,0x72,  -1, 137}, {0x6f,0x73,  -1, 152}, {0x20,0x74,  -1,  -1}, {0x6f,0x75,  -1, 160}, 
+    {0x74,0x76,  -1,  -1}, {0x65,0x77,  -1,  -1}, {0x61,0x78,  -1, 181}, {0x20,0x79,  -1, 276}, 
+    {0x72,0x7a,  -1,  -1}, {0x6d,0x7b, 271, 147}, {0x20,0x7c,  -1, 184}, {0x70,0x7d,  -1, 189}, 
+    {0x20,0x7e,  -1,  -1}, {0x79,0x7f,  -1, 203}, {0x79,0x80,  -1, 235}, {0x69,0x81, 267,  -1}, 
+    {0x61,0x82,  -1, 245}, {0x63,0x83,  -1, 211}, {0x6f,0xb7, 155, 163}, {0x74,0x84,  -1,  -1}, 
+    {0x2c,0xb6, 157, 190}, {0x20,0x85,  -1,  -1}, {0x74,0x86,  -1,  -1}, {0x20,0x87,  -1, 231}, 
+    {0x65,0x88,  -1, 175}, {0x61,0x89,  -1, 173}, {0x20,0x8a,  -1, 212}, {0x65,0x8b,  -1, 217}, 
+    {0x20,0x8c,  -1, 237}, {0x6f,0x8d,  -1,  -1}, {0x20,0x8e,  -1, 200}, {0x74,0x8f,  -1,  -1}, 
+    {0x20,0x92,  -1,  -1}, {0x6d,0x93,  -1, 247}, {0x61,0x94,  -1,  -1}, {0x6f,0x95,  -1, 198}, 
+    {0x72,0x96,  -1, 188}, {0x69,0x97,  -1, 174}, {0x6c,0x98,  -1, 207}, {0x68,0x99, 218,  -1}, 
+    {0x64,0x9a,  -1, 215}, {0x69,0xff, 178, 251}, {0x73,0x9b,  -1,  -1}, {0x74,0x9c,  -1, 186}, 
+    {0x20,0x9d,  -1, 272}, {0x0d,0xff, 182, 205}, {0x0a,0x9e,  -1,  -1}, {0x68,0x9f,  -1, 210}, 
+    {0x65,0xa0,  -1,  -1}, {0x6f,0xa1,  -1, 261}, {0x6f,0xa2,  -1, 208}, {0x20,0xa3,  -1, 256}, 
+    {0x73,0xa4,  -1, 220}, {0x64,0xa5,  -1, 197}, {0x73,0xa6,  -1, 206}, {0x0d,0xff, 192,  -1}, 
+    {0x0a,0xa7,  -1,  -1}, {0x0d,0xa8,  -1,  -1}, {0x3d,0xff, 195, 221}, {0x22,0xa9,  -1,  -1}, 
+    {0x65,0xaa,  -1,  -1}, {0x65,0xab,  -1, 214}, {0x61,0xac,  -1, 216}, {0x61,0xad,  -1,  -1}, 
+    {0x65,0xae,  -1,  -1}, {0x74,0xaf,  -1,  -1}, {0x20,0xb0,  -1,  -1}, {0x75,0xff, 204,  -1}, 
+    {0x74,0xb1,  -1,  -1}, {0x6c,0xb2,  -1, 240}, {0x6f,0xb3,  -1, 238}, {0x20,0xb4,  -1, 224}, 
+    {0x73,0xb5,  -1, 213}, {0x72,0xb8,  -1,  -1}, {0x61,0xb9,  -1, 257}, {0x76,0xba,  -1, 250}, 
+    {0x6f,0xbb,  -1,  -1}, {0x61,0xbc,  -1, 274}, {0x72,0xbd, 234, 230}, {0x74,0xbe,  -1, 222}, 
+    {0x74,0xbf,  -1,  -1}, {0x73,0xc0,  -1, 252}, {0x20,0xc1,  -1,  -1}, {0x72,0xc3,  -1, 226}, 
+    {0x74,0xc4,  -1, 248}, {0x2f,0xc5,  -1, 229}, {0x76,0xff, 223,  -1}, {0x65,0xc6,  -1,  -1}, 
+    {0x79,0xea, 225,  -1}, {0x20,0xc7,  -1,  -1}, {0x61,0xc8,  -1,  -1}, {0x61,0xc9,  -1,  -1}, 
+    {0x6e,0xca,  -1,  -1}, {0x2d,0xcc,  -1, 244}, {0x6c,0xcd,  -1, 259}, {0x69,0xce,  -1, 253}, 
+    {0x20,0xcf,  -1,  -1}, {0x65,0xd0,  -1,  -1}, {0x65,0xd1,  -1,  -1}, {0x72,0xff, 236,  -1}, 
+    {0x65,0xd2,  -1,  -1}, {0x73,0xd3,  -1,  -1}, {0x69,0xd4,  -1,  -1}, {0x6f,0xd5,  -1,  -1}, 
+    {0x63,0xd7,  -1, 258}, {0x72,0xd8,  -1,  -1}, {0x6f,0xd9,  -1,  -1}, {0x73,0xda,  -1,  -1}, 
+    {0x7a,0xdb,  -1, 246}, {0x73,0xdd,  -1, 265}, {0x3e,0xde, 254, 249}, {0x74,0xdf,  -1,  -1}, 
+    {0x6e,0xe0,  -1,  -1}, {0x3c,0xe1, 264, 273}, {0x6d,0xe2,  -1, 260}, {0x20,0xe3,  -1,  -1}, 
+    {0x63,0xe4,  -1,  -1}, {0x65,0xe5,  -1,  -1}, {0x3c,0xe6,  -1,  -1}, {0x72,0xe7,  -1,  -1}, 
+    {0x64,0xe8,  -1, 262}, {0x65,0xe9,  -1, 266}, {0x65,0xeb,  -1, 268}, {0x6e,0xec,  -1,  -1}, 
+    {0x64,0xed,  -1, 263}, {0x6c,0xee,  -1,  -1}, {0x63,0xef,  -1,  -1}, {0x6c,0xf0,  -1,  -1}, 
+    {0x2f,0xf1,  -1,  -1}, {0x74,0xf2,  -1,  -1}, {0x69,0xf3,  -1,  -1}, {0x76,0xf4,  -1,  -1}, 
+    {0x2c,0xff, 269,  -1}, {0x20,0xf5,  -1,  -1}, {0x74,0xf6,  -1,  -1}, {0x61,0xf8,  -1,  -1}, 
+    {0x65,0xf9,  -1,  -1}, {0x78,0xfa,  -1,  -1}, {0x63,0xfb,  -1,  -1}, {0x6e,0xfc,  -1,  -1}, 
+    {0x63,0xff, 277,  -1}, {0x6f,0xff, 278,  -1}, {0x6d,0xfd,  -1,  -1}, 
+};
+
+#endif /* _SMAZ_TRIE_H_ */